@@ -0,0 +1,15 @@
+#version 450 core
+
+// NOTE: the attr_ inputs are generated from the vertex format of the glyph pipeline
+
+uniform mat4 projection;
+
+out vec3 vertex_color;
+out vec2 vertex_uvs;
+
+void main()
+{
+    gl_Position = projection * vec4(attr_position, attr_depth, 1.0);
+    vertex_color = attr_color;
+    vertex_uvs = attr_uvs;
+}
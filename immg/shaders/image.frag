@@ -0,0 +1,11 @@
+#version 450 core
+
+in vec2 vertex_uvs;
+out vec4 color;
+
+uniform sampler2D sampler_image;
+
+void main()
+{
+    color = texture(sampler_image, vertex_uvs);
+}
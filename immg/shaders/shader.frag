@@ -1,13 +1,64 @@
 #version 450 core
 
-in vec3 vertex_color;
-in vec2 vertex_uvs;
+// NOTE: same values as imm_primitive_kind_t
+#define PRIMITIVE_ROUNDED_RECT 0
+#define PRIMITIVE_CIRCLE 1
+#define PRIMITIVE_SHADOW 2
+#define PRIMITIVE_LINE 3
+
+// NOTE: glyphs, images and solid quads have their own pipeline, only the shapes come here
+in vec4 vertex_color;
+in vec2 vertex_local;
+flat in vec2 vertex_half_size;
+flat in vec4 vertex_shape;
 out vec4 color;
 
-uniform sampler2D sampler_texture;
+float sdf_rounded_rect(vec2 p, vec2 half_size, float radius)
+{
+    vec2 q = abs(p) - half_size + vec2(radius);
+    return length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;
+}
+
+// NOTE: distances are in pixels so half a pixel each side gives the anti-aliasing
+float sdf_coverage(float d, float border)
+{
+    float result = clamp(0.5 - d, 0.0, 1.0);
+    if(border > 0.0)
+    {
+        result *= clamp(0.5 + d + border, 0.0, 1.0);
+    }
+    return result;
+}
 
 void main()
 {
-    color = vec4(1.0, 1.0, 1.0, texture(sampler_texture, vertex_uvs).r);
-    //color = texture(sampler_texture, vertex_uvs);
+    int kind = int(vertex_shape.w + 0.5);
+    float radius = vertex_shape.x;
+    float border = vertex_shape.y;
+    float softness = vertex_shape.z;
+    
+    float alpha = 1.0;
+    if(kind == PRIMITIVE_ROUNDED_RECT)
+    {
+        float r = min(radius, min(vertex_half_size.x, vertex_half_size.y));
+        alpha = sdf_coverage(sdf_rounded_rect(vertex_local, vertex_half_size, r), border);
+    }
+    else if(kind == PRIMITIVE_CIRCLE)
+    {
+        alpha = sdf_coverage(length(vertex_local) - radius, border);
+    }
+    else if(kind == PRIMITIVE_SHADOW)
+    {
+        vec2 half_size = vertex_half_size - vec2(softness);
+        float r = min(radius, min(half_size.x, half_size.y));
+        float d = sdf_rounded_rect(vertex_local, half_size, r);
+        alpha = 1.0 - smoothstep(-softness, softness, d);
+    }
+    else if(kind == PRIMITIVE_LINE)
+    {
+        // NOTE: local.y is the distance to the center of the line and radius the half width
+        alpha = clamp(radius + 0.5 - abs(vertex_local.y), 0.0, 1.0);
+    }
+    
+    color = vec4(vertex_color.rgb, vertex_color.a * alpha);
 }
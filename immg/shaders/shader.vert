@@ -1,17 +1,19 @@
 #version 450 core
 
-layout (location = 0) in vec2 attr_position;
-layout (location = 1) in vec2 attr_uvs;
-layout (location = 2) in vec3 attr_color;
+// NOTE: the attr_ inputs are generated from the vertex format of the sdf pipeline
 
 uniform mat4 projection;
 
-out vec3 vertex_color;
-out vec2 vertex_uvs;
+out vec4 vertex_color;
+out vec2 vertex_local;
+flat out vec2 vertex_half_size;
+flat out vec4 vertex_shape;
 
 void main()
 {
-    gl_Position = projection * vec4(attr_position, 0.0, 1.0);
+    gl_Position = projection * vec4(attr_position, attr_depth, 1.0);
     vertex_color = attr_color;
-    vertex_uvs = attr_uvs;
+    vertex_local = attr_local;
+    vertex_half_size = attr_half_size;
+    vertex_shape = attr_shape;
 }
@@ -0,0 +1,109 @@
+#ifndef IMM_ARENA_H
+#define IMM_ARENA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include "imm_core.h"
+#include "imm_memory.h"
+
+// NOTE: linear allocator for memory that only lives until the end of the frame.
+// The memory is reserved once at init and the frame only moves the cursor, so
+// formatting labels or building temporary arrays never touch the heap
+
+struct imm_arena_t
+{
+    u8 *base;
+    u64 size;
+    u64 used;
+
+    // NOTE: the biggest frame since init, and the allocations that did not fit
+    u64 high_water;
+    u64 failed;
+};
+
+// NOTE: length delimited string, the data is not null terminated
+struct imm_str_t
+{
+    char *data;
+    u32 length;
+};
+
+// NOTE: use it to pass a imm_str_t to a printf style function with "%.*s"
+#define imm_str_arg(s) (int)(s).length, (s).data
+
+void imm_arena_init(imm_arena_t *arena, u64 size)
+{
+    arena->base = (u8 *)imm_alloc(size, memory_tag_arena);
+    arena->size = size;
+    arena->used = 0;
+    arena->high_water = 0;
+    arena->failed = 0;
+}
+
+void imm_arena_free(imm_arena_t *arena)
+{
+    imm_free(arena->base);
+    arena->base = 0;
+    arena->size = 0;
+    arena->used = 0;
+}
+
+// NOTE: alignment must be a power of two, return 0 if the arena is full
+void *imm_arena_push(imm_arena_t *arena, u64 size, u64 alignment = 16)
+{
+    u64 start = (arena->used + (alignment - 1)) & ~(alignment - 1);
+    if((start + size) > arena->size)
+    {
+        arena->failed++;
+        return 0;
+    }
+    arena->used = start + size;
+    return arena->base + start;
+}
+
+#define imm_arena_push_array(arena, type, count) (type *)imm_arena_push((arena), sizeof(type) * (count), alignof(type))
+
+void imm_arena_reset(imm_arena_t *arena)
+{
+    if(arena->used > arena->high_water)
+    {
+        arena->high_water = arena->used;
+    }
+    arena->used = 0;
+}
+
+// NOTE: format straight into the free space of the arena, only the characters are
+// committed so the null terminator is overwritten by the next allocation
+imm_str_t imm_text_f(imm_arena_t *arena, const char *format, ...)
+{
+    imm_str_t result = {};
+    char *data = (char *)(arena->base + arena->used);
+    u64 available = arena->size - arena->used;
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(data, (size_t)available, format, args);
+    va_end(args);
+
+    if((length < 0) || ((u64)length >= available))
+    {
+        arena->failed++;
+        return result;
+    }
+    arena->used += (u64)length;
+    result.data = data;
+    result.length = (u32)length;
+    return result;
+}
+
+void imm_arena_stats_print(imm_arena_t *arena, const char *name)
+{
+    printf("[arena]: %s %llu/%llu bytes used, high water %llu bytes (%.1f%%), %llu failed allocations\n",
+           name, (unsigned long long)arena->used, (unsigned long long)arena->size,
+           (unsigned long long)arena->high_water, arena->size ? ((f64)arena->high_water * 100.0 / (f64)arena->size) : 0.0,
+           (unsigned long long)arena->failed);
+}
+
+#endif // IMM_ARENA_H
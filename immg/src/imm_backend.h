@@ -0,0 +1,140 @@
+#ifndef IMM_BACKEND_H
+#define IMM_BACKEND_H
+
+#include <SDL.h>
+#include "imm_math.h"
+
+// NOTE: everything the gui needs from the graphics api. The gui only builds vertices
+// and indices on the cpu and talk with the backend through this table, so a new api
+// only has to fill it. Textures, programs and buffers of the backend are shared by
+// every window, a window only owns what can not be shared (swap chain, vertex layout
+// objects and queries)
+
+enum imm_texture_format_t
+{
+    texture_format_r8,
+    texture_format_rgba8,
+};
+
+// NOTE: one attribute of the vertex format, the offset is in bytes and the name is
+// the input of the vertex shader
+struct imm_vertex_attribute_t
+{
+    u32 location;
+    u32 count;
+    u32 offset;
+    const char *name;
+};
+
+#define imm_backend_max_attributes 16
+#define imm_backend_max_pipelines 8
+
+// NOTE: every pipeline has its own vertex format and program, capacity is the
+// number of vertices of the format the backend reserves for a frame
+struct imm_vertex_layout_t
+{
+    imm_vertex_attribute_t attributes[imm_backend_max_attributes];
+    u32 attribute_count;
+    u32 stride;
+    u32 capacity;
+};
+
+struct imm_window_t
+{
+    SDL_Window *window;
+    void *context;
+    u32 id;
+    s32 width;
+    s32 height;
+    bool open;
+
+    // NOTE: backend objects that can not be shared between windows
+    unsigned int vertex_arrays[imm_backend_max_pipelines];
+    unsigned int vertex_buffer;
+    unsigned int index_buffer;
+    u64 vertex_buffer_size;
+    u64 index_buffer_size;
+    unsigned int queries[2];
+    u32 query_frame;
+    // NOTE: hidden windows draw into their own color and depth buffers, 0 for the others
+    unsigned int framebuffer;
+    unsigned int renderbuffers[2];
+
+    // NOTE: samples shaded by the last finished frame of the window
+    u64 samples;
+};
+
+// NOTE: a range of the blended indices drawn with one pipeline, a texture other than
+// 0 is bound to the unit 1 instead of the one of the list
+struct imm_draw_command_t
+{
+    u32 pipeline;
+    u32 texture;
+    u32 index_offset;
+    u32 index_count;
+};
+
+struct imm_render_stream_t
+{
+    void *vertices;
+    u32 count;
+};
+
+// NOTE: the geometry of one frame. The indices are relative to the vertices of the
+// pipeline they are drawn with. The opaque indices are already front to back and
+// are drawn first without blending with the opaque pipeline, the commands are drawn
+// in order with blending
+struct imm_render_list_t
+{
+    imm_render_stream_t streams[imm_backend_max_pipelines];
+    u32 *opaque_indices;
+    u32 opaque_index_count;
+    u32 opaque_pipeline;
+    u32 *indices;
+    u32 index_count;
+    imm_draw_command_t *commands;
+    u32 command_count;
+
+    v4 clear_color;
+    // NOTE: texture bound to every texture unit of the program
+    u32 textures[2];
+    // NOTE: size in pixels of the window the list was pushed for, a window of another
+    // size scales the list to fit
+    s32 width;
+    s32 height;
+};
+
+struct imm_backend_t
+{
+    const char *name;
+
+    // NOTE: the first window creates the shared context, the vertex layouts must be set before.
+    // There is one layout per pipeline, a layout without attributes is a unused pipeline.
+    // A window opened with SDL_WINDOW_HIDDEN renders offscreen, for tools and tests
+    bool (*window_open)(imm_window_t *window, const char *title, s32 width, s32 height, u32 flags);
+    void (*window_close)(imm_window_t *window);
+    void (*vertex_layout)(imm_vertex_layout_t *layouts, u32 layout_count, u64 index_buffer_size);
+    // NOTE: vertex_inputs are the attribute declarations of the vertex shader
+    bool (*program_load)(u32 pipeline, const char *vertex, const char *fragment, const char *vertex_inputs);
+
+    u32 (*texture_create)(u32 width, u32 height, imm_texture_format_t format, void *pixels);
+    void (*texture_update)(u32 texture, u32 x, u32 y, u32 width, u32 height, imm_texture_format_t format, void *pixels, u32 pitch);
+    void (*texture_destroy)(u32 texture);
+    // NOTE: memory the driver copies from, so a big image is written once by the cpu.
+    // staging_end copies the tightly packed rows into the texture and releases the
+    // memory, with texture 0 it only releases it. One staging at a time
+    void *(*texture_staging_begin)(u64 size);
+    void (*texture_staging_end)(u32 texture, u32 width, u32 height, imm_texture_format_t format);
+
+    void (*buffer_upload)(imm_window_t *window, imm_render_list_t *list);
+    void (*submit)(imm_window_t *window, imm_render_list_t *list);
+    void (*present)(imm_window_t *window);
+    // NOTE: width * height rgba pixels of the last submit, the first row is the top of
+    // the window. It waits for the gpu, never use it in a frame
+    void (*read_pixels)(imm_window_t *window, u8 *pixels);
+};
+
+// NOTE: the backend used by every subsystem, set once at startup
+static imm_backend_t *imm_backend;
+
+#endif // IMM_BACKEND_H
@@ -0,0 +1,696 @@
+#ifndef IMM_BACKEND_GL_H
+#define IMM_BACKEND_GL_H
+
+#include <SDL.h>
+#include <glad/glad.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "imm_math.h"
+#include "imm_memory.h"
+#include "imm_state.h"
+#include "imm_texture.h"
+#include "imm_backend.h"
+
+// NOTE: opengl 4.5 backend. All the windows share the objects of the first context
+// (textures, buffers and programs), so the atlas and the images are created and 
+// updated once no matter how many windows draw them
+
+unsigned int imm_compile_gl_shader(GLenum type, const char *source, const char *error_tag)
+{
+    int compile_status;
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, 0);
+    glCompileShader(shader);
+    
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
+    if(compile_status != GL_TRUE)
+    {
+        u64 log_length = 0;
+        char message[1024];
+        glGetShaderInfoLog(shader, 1024, (GLsizei *)&log_length, message);
+        printf("[%s]:\n%s\n", error_tag, message);
+    }
+    return shader;
+}
+
+// NOTE: the program binary cache is saved next to the shaders, one file per program.
+// The key keeps the driver strings as they are and a 64 bits hash and the size of
+// both sources, any driver update or shader edit makes the binary useless and the
+// program is compiled again and saved
+#define imm_program_cache_magic 0x504D4D49 // NOTE: 'IMMP'
+#define imm_program_cache_version 2
+#define imm_program_cache_driver_length 128
+
+struct imm_program_cache_key_t
+{
+    char vendor[imm_program_cache_driver_length];
+    char renderer[imm_program_cache_driver_length];
+    char version[imm_program_cache_driver_length];
+    u64 vertex_hash;
+    u64 vertex_size;
+    u64 fragment_hash;
+    u64 fragment_size;
+};
+
+struct imm_program_cache_header_t
+{
+    u32 magic;
+    u32 version;
+    imm_program_cache_key_t key;
+    u32 format;
+    u32 size;
+};
+
+// NOTE: the key is memset so the whole struct can be written and compared as bytes
+void imm_program_cache_key(imm_program_cache_key_t *key, char *vertex_source, u64 vertex_size, char *fragment_source, u64 fragment_size)
+{
+    memset(key, 0, sizeof(*key));
+    const char *vendor = (const char *)glGetString(GL_VENDOR);
+    const char *renderer = (const char *)glGetString(GL_RENDERER);
+    const char *version = (const char *)glGetString(GL_VERSION);
+    snprintf(key->vendor, sizeof(key->vendor), "%s", vendor ? vendor : "");
+    snprintf(key->renderer, sizeof(key->renderer), "%s", renderer ? renderer : "");
+    snprintf(key->version, sizeof(key->version), "%s", version ? version : "");
+    key->vertex_hash = imm_hash_64(vertex_source, vertex_size);
+    key->vertex_size = vertex_size;
+    key->fragment_hash = imm_hash_64(fragment_source, fragment_size);
+    key->fragment_size = fragment_size;
+}
+
+unsigned int imm_program_cache_load(const char *path, imm_program_cache_key_t *key)
+{
+    FILE *file = fopen(path, "rb");
+    if(!file)
+    {
+        return 0;
+    }
+
+    unsigned int program = 0;
+    imm_program_cache_header_t header = {};
+    if((fread(&header, sizeof(header), 1, file) == 1) && (header.magic == imm_program_cache_magic) &&
+       (header.version == imm_program_cache_version) && (memcmp(&header.key, key, sizeof(*key)) == 0) && header.size)
+    {
+        void *binary = imm_alloc(header.size, memory_tag_file_io);
+        if(fread(binary, header.size, 1, file) == 1)
+        {
+            int program_link;
+            program = glCreateProgram();
+            glProgramBinary(program, (GLenum)header.format, binary, (GLsizei)header.size);
+            glGetProgramiv(program, GL_LINK_STATUS, &program_link);
+            if(program_link != GL_TRUE)
+            {
+                // NOTE: the driver can reject a binary even with the same version strings
+                glDeleteProgram(program);
+                program = 0;
+            }
+        }
+        imm_free(binary);
+    }
+    fclose(file);
+    return program;
+}
+
+void imm_program_cache_save(const char *path, imm_program_cache_key_t *key, unsigned int program)
+{
+    int size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if(size <= 0)
+    {
+        return;
+    }
+    
+    void *binary = imm_alloc(size, memory_tag_file_io);
+    GLenum format = 0;
+    glGetProgramBinary(program, size, &size, &format, binary);
+
+    FILE *file = fopen(path, "wb");
+    if(file)
+    {
+        imm_program_cache_header_t header = {};
+        header.magic = imm_program_cache_magic;
+        header.version = imm_program_cache_version;
+        header.key = *key;
+        header.format = (u32)format;
+        header.size = (u32)size;
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(binary, size, 1, file);
+        fclose(file);
+    }
+    else
+    {
+        printf("[program-cache-error]: could not write %s\n", path);
+    }
+    imm_free(binary);
+}
+
+// NOTE: the generated inputs go after the first line of the vertex shader, the #version
+char *imm_insert_vertex_inputs(char *source, u64 *size, const char *inputs)
+{
+    u64 inputs_size = inputs ? strlen(inputs) : 0;
+    if(!inputs_size)
+    {
+        return source;
+    }
+    char *line_end = strchr(source, '\n');
+    u64 head = line_end ? (u64)(line_end - source) + 1 : *size;
+    char *result = (char *)imm_alloc(*size + inputs_size + 1, memory_tag_file_io);
+    memcpy(result, source, head);
+    memcpy(result + head, inputs, inputs_size);
+    memcpy(result + head + inputs_size, source + head, *size - head + 1);
+    *size += inputs_size;
+    imm_free(source);
+    return result;
+}
+
+unsigned int imm_load_gl_shader(const char *vertex, const char *fragment, const char *vertex_inputs)
+{
+    f64 frequency = (f64)SDL_GetPerformanceFrequency();
+    u64 read_start = SDL_GetPerformanceCounter();
+    
+    u64 vertex_size, fragment_size;
+    char *vertex_file = (char *)imm_read_entire_file(vertex, &vertex_size);
+    char *fragment_file = (char *)imm_read_entire_file(fragment, &fragment_size);
+    if(!vertex_file || !fragment_file)
+    {
+        imm_free(vertex_file);
+        imm_free(fragment_file);
+        return 0;
+    }
+    vertex_file = imm_insert_vertex_inputs(vertex_file, &vertex_size, vertex_inputs);
+    
+    // NOTE: drivers without binary formats can still retrieve a binary, but can never load it
+    int binary_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_formats);
+    
+    // NOTE: the same fragment shader can be linked with different vertex shaders, so the
+    // name has the hash of the vertex path, not an id that depends on the id stack. The
+    // generated inputs are part of the vertex source so they are in the key
+    char cache_path[512];
+    snprintf(cache_path, sizeof(cache_path), "%s.%08x.bin", fragment, imm_id_hash((char *)vertex, (u32)strlen(vertex), imm_id_fnv_offset));
+    imm_program_cache_key_t key;
+    imm_program_cache_key(&key, vertex_file, vertex_size, fragment_file, fragment_size);
+    
+    u64 cache_start = SDL_GetPerformanceCounter();
+    unsigned int program = binary_formats ? imm_program_cache_load(cache_path, &key) : 0;
+    u64 cache_end = SDL_GetPerformanceCounter();
+    
+    u64 compile_ticks = 0;
+    u64 link_ticks = 0;
+    u64 save_ticks = 0;
+    if(!program)
+    {
+        u64 compile_start = SDL_GetPerformanceCounter();
+        unsigned int vertex_shader = imm_compile_gl_shader(GL_VERTEX_SHADER, vertex_file, "vertex-shader-error");
+        unsigned int fragment_shader = imm_compile_gl_shader(GL_FRAGMENT_SHADER, fragment_file, "fragment-shader-error");
+        u64 link_start = SDL_GetPerformanceCounter();
+        compile_ticks = link_start - compile_start;
+        
+        int program_link;
+        program = glCreateProgram();
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(program, vertex_shader);
+        glAttachShader(program, fragment_shader);
+        glLinkProgram(program);
+         
+        glGetProgramiv(program, GL_LINK_STATUS, &program_link);
+        u64 save_start = SDL_GetPerformanceCounter();
+        link_ticks = save_start - link_start;
+        if(program_link != GL_TRUE)
+        {
+            u64 log_length = 0;
+            char message[1024];
+            glGetProgramInfoLog(program, 1024, (GLsizei *)&log_length, message);
+            printf("[program-link-error]:\n%s\n", message);
+        }
+        else if(binary_formats)
+        {
+            imm_program_cache_save(cache_path, &key, program);
+        }
+        save_ticks = SDL_GetPerformanceCounter() - save_start;
+        
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
+    }
+
+    imm_free(vertex_file);
+    imm_free(fragment_file);
+
+    printf("[shader]: %s %s, read %.3f ms, cache %s %.3f ms, compile %.3f ms, link %.3f ms, save %.3f ms\n",
+           vertex, fragment,
+           (f64)(cache_start - read_start) * 1000.0 / frequency,
+           compile_ticks ? "miss" : "hit", (f64)(cache_end - cache_start) * 1000.0 / frequency,
+           (f64)compile_ticks * 1000.0 / frequency, (f64)link_ticks * 1000.0 / frequency,
+           (f64)save_ticks * 1000.0 / frequency);
+
+    return program;
+}
+
+struct imm_backend_gl_t
+{
+    SDL_Window *shared_window;
+    SDL_GLContext shared_context;
+    imm_window_t *current;
+    u32 window_count;
+
+    unsigned int programs[imm_backend_max_pipelines];
+    int projection_locations[imm_backend_max_pipelines];
+
+    // NOTE: the vertices of every pipeline have a fixed range of the vertex buffer
+    imm_vertex_layout_t layouts[imm_backend_max_pipelines];
+    u64 vertex_offsets[imm_backend_max_pipelines];
+    u32 layout_count;
+    u64 vertex_buffer_size;
+    u64 index_buffer_size;
+
+    // NOTE: pixel unpack buffer of texture_staging_begin
+    unsigned int staging_buffer;
+    u64 staging_size;
+};
+
+static imm_backend_gl_t imm_gl;
+
+void imm_gl_make_current(imm_window_t *window)
+{
+    if(imm_gl.current != window)
+    {
+        // NOTE: flush so the other contexts see the texture updates of this one
+        glFlush();
+        SDL_GL_MakeCurrent(window->window, (SDL_GLContext)window->context);
+        imm_gl.current = window;
+    }
+}
+
+void imm_gl_vertex_layout(imm_vertex_layout_t *layouts, u32 layout_count, u64 index_buffer_size)
+{
+    assert(layout_count <= imm_backend_max_pipelines);
+    u64 offset = 0;
+    for(u32 i = 0; i < layout_count; ++i)
+    {
+        imm_gl.layouts[i] = layouts[i];
+        imm_gl.vertex_offsets[i] = offset;
+        offset += (u64)layouts[i].capacity * layouts[i].stride;
+    }
+    imm_gl.layout_count = layout_count;
+    imm_gl.vertex_buffer_size = offset;
+    imm_gl.index_buffer_size = index_buffer_size;
+}
+
+bool imm_gl_window_open(imm_window_t *window, const char *title, s32 width, s32 height, u32 flags)
+{
+    int error = 0;
+    if(imm_gl.shared_context)
+    {
+        // NOTE: the new context must be created with the shared one current
+        SDL_GL_MakeCurrent(imm_gl.shared_window, imm_gl.shared_context);
+        error += SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+    }
+    error += SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+    error += SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 5);
+    error += SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+    if(error)
+    {
+        printf("[gl-error]: %s\n", SDL_GetError());
+    }
+
+    s32 position = imm_gl.shared_context ? SDL_WINDOWPOS_UNDEFINED : SDL_WINDOWPOS_CENTERED;
+    window->window = SDL_CreateWindow(title, position, position, width, height, SDL_WINDOW_OPENGL | flags);
+    if(!window->window)
+    {
+        printf("[gl-error]: could not create window %s: %s\n", title, SDL_GetError());
+        return false;
+    }
+    window->context = SDL_GL_CreateContext(window->window);
+    if(!window->context)
+    {
+        printf("[gl-error]: could not create context: %s\n", SDL_GetError());
+        SDL_DestroyWindow(window->window);
+        window->window = 0;
+        return false;
+    }
+    imm_gl.current = window;
+    
+    if(!imm_gl.shared_context)
+    {
+        if(!gladLoadGL())
+        {
+            printf("[gl-error]: error initiallising GLAD\n");
+        }
+        imm_gl.shared_window = window->window;
+        imm_gl.shared_context = (SDL_GLContext)window->context;
+    }
+    imm_gl.window_count++;
+    
+    window->id = SDL_GetWindowID(window->window);
+    window->width = width;
+    window->height = height;
+    window->query_frame = 0;
+    window->samples = 0;
+    window->open = true;
+
+    // NOTE: vertex arrays and queries are not shared, every context has its own
+    // buffers too so the windows never wait for each other
+    window->vertex_buffer_size = imm_gl.vertex_buffer_size;
+    window->index_buffer_size = imm_gl.index_buffer_size;
+    glCreateBuffers(1, &window->vertex_buffer);
+    glNamedBufferData(window->vertex_buffer, window->vertex_buffer_size, 0, GL_DYNAMIC_DRAW);
+    glCreateBuffers(1, &window->index_buffer);
+    glNamedBufferData(window->index_buffer, window->index_buffer_size, 0, GL_DYNAMIC_DRAW);
+    imm_memory_track(memory_tag_gpu_buffer, window->vertex_buffer_size + window->index_buffer_size);
+
+    // NOTE: one vertex array per pipeline, all read the same buffers from the range of the pipeline
+    glCreateVertexArrays(imm_gl.layout_count, window->vertex_arrays);
+    for(u32 pipeline = 0; pipeline < imm_gl.layout_count; ++pipeline)
+    {
+        imm_vertex_layout_t *layout = imm_gl.layouts + pipeline;
+        unsigned int vertex_array = window->vertex_arrays[pipeline];
+        if(!layout->attribute_count)
+        {
+            continue;
+        }
+        glVertexArrayVertexBuffer(vertex_array, 0, window->vertex_buffer, imm_gl.vertex_offsets[pipeline], layout->stride);
+        glVertexArrayElementBuffer(vertex_array, window->index_buffer);
+        for(u32 i = 0; i < layout->attribute_count; ++i)
+        {
+            imm_vertex_attribute_t *attribute = layout->attributes + i;
+            glEnableVertexArrayAttrib(vertex_array, attribute->location);
+            glVertexArrayAttribFormat(vertex_array, attribute->location, attribute->count, GL_FLOAT, GL_FALSE, attribute->offset);
+            glVertexArrayAttribBinding(vertex_array, attribute->location, 0);
+        }
+    }
+    glCreateQueries(GL_SAMPLES_PASSED, 2, window->queries);
+
+    // NOTE: the pixels of a hidden window are not owned by the context, the default
+    // framebuffer can not be read back, so it gets a framebuffer of the same size
+    window->framebuffer = 0;
+    if(flags & SDL_WINDOW_HIDDEN)
+    {
+        glCreateFramebuffers(1, &window->framebuffer);
+        glCreateRenderbuffers(2, window->renderbuffers);
+        glNamedRenderbufferStorage(window->renderbuffers[0], GL_RGBA8, width, height);
+        glNamedRenderbufferStorage(window->renderbuffers[1], GL_DEPTH_COMPONENT24, width, height);
+        glNamedFramebufferRenderbuffer(window->framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, window->renderbuffers[0]);
+        glNamedFramebufferRenderbuffer(window->framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, window->renderbuffers[1]);
+        if(glCheckNamedFramebufferStatus(window->framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            printf("[gl-error]: offscreen framebuffer of %s is not complete\n", title);
+        }
+        imm_memory_track(memory_tag_gpu_texture, (u64)width * height * 8);
+    }
+    return true;
+}
+
+void imm_gl_window_close(imm_window_t *window)
+{
+    if(!window->open)
+    {
+        return;
+    }
+    imm_gl_make_current(window);
+    glDeleteQueries(2, window->queries);
+    glDeleteVertexArrays(imm_gl.layout_count, window->vertex_arrays);
+    glDeleteBuffers(1, &window->vertex_buffer);
+    glDeleteBuffers(1, &window->index_buffer);
+    imm_memory_untrack(memory_tag_gpu_buffer, window->vertex_buffer_size + window->index_buffer_size);
+    if(window->framebuffer)
+    {
+        glDeleteFramebuffers(1, &window->framebuffer);
+        glDeleteRenderbuffers(2, window->renderbuffers);
+        imm_memory_untrack(memory_tag_gpu_texture, (u64)window->width * window->height * 8);
+        window->framebuffer = 0;
+    }
+
+    // NOTE: the shared context keeps the shared objects alive, it must be the last one closed
+    imm_gl.window_count--;
+    if(window->context == imm_gl.shared_context)
+    {
+        for(u32 pipeline = 0; pipeline < imm_backend_max_pipelines; ++pipeline)
+        {
+            glDeleteProgram(imm_gl.programs[pipeline]);
+            imm_gl.programs[pipeline] = 0;
+        }
+        imm_gl.shared_context = 0;
+        imm_gl.shared_window = 0;
+    }
+    else if(imm_gl.shared_context)
+    {
+        SDL_GL_MakeCurrent(imm_gl.shared_window, imm_gl.shared_context);
+    }
+    SDL_GL_DeleteContext((SDL_GLContext)window->context);
+    SDL_DestroyWindow(window->window);
+    imm_gl.current = 0;
+    window->context = 0;
+    window->window = 0;
+    window->open = false;
+}
+
+bool imm_gl_program_load(u32 pipeline, const char *vertex, const char *fragment, const char *vertex_inputs)
+{
+    unsigned int program = imm_load_gl_shader(vertex, fragment, vertex_inputs);
+    if(!program)
+    {
+        return false;
+    }
+    if(imm_gl.programs[pipeline])
+    {
+        glDeleteProgram(imm_gl.programs[pipeline]);
+    }
+    imm_gl.programs[pipeline] = program;
+    imm_gl.projection_locations[pipeline] = glGetUniformLocation(program, "projection");
+    glProgramUniform1i(program, glGetUniformLocation(program, "sampler_texture"), 0);
+    glProgramUniform1i(program, glGetUniformLocation(program, "sampler_image"), 1);
+    return true;
+}
+
+inline u32 imm_gl_texture_bytes_per_pixel(imm_texture_format_t format)
+{
+    return format == texture_format_r8 ? 1 : 4;
+}
+
+void imm_gl_texture_update(u32 texture, u32 x, u32 y, u32 width, u32 height, imm_texture_format_t format, void *pixels, u32 pitch)
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch / imm_gl_texture_bytes_per_pixel(format));
+    glTextureSubImage2D(texture, 0, x, y, width, height, format == texture_format_r8 ? GL_RED : GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+u32 imm_gl_texture_create(u32 width, u32 height, imm_texture_format_t format, void *pixels)
+{
+    unsigned int texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, format == texture_format_r8 ? GL_R8 : GL_RGBA8, width, height);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if(pixels)
+    {
+        imm_gl_texture_update(texture, 0, 0, width, height, format, pixels, width * imm_gl_texture_bytes_per_pixel(format));
+    }
+    imm_memory_track(memory_tag_gpu_texture, (u64)width * height * imm_gl_texture_bytes_per_pixel(format));
+    return texture;
+}
+
+void imm_gl_texture_destroy(u32 texture)
+{
+    int width = 0;
+    int height = 0;
+    int format = 0;
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+    imm_memory_untrack(memory_tag_gpu_texture, (u64)width * height * (format == GL_R8 ? 1 : 4));
+    unsigned int name = texture;
+    glDeleteTextures(1, &name);
+}
+
+void *imm_gl_texture_staging_begin(u64 size)
+{
+    assert(!imm_gl.staging_buffer);
+    glCreateBuffers(1, &imm_gl.staging_buffer);
+    glNamedBufferData(imm_gl.staging_buffer, size, 0, GL_STREAM_DRAW);
+    imm_gl.staging_size = size;
+    imm_memory_track(memory_tag_gpu_buffer, size);
+    return glMapNamedBufferRange(imm_gl.staging_buffer, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+}
+
+void imm_gl_texture_staging_end(u32 texture, u32 width, u32 height, imm_texture_format_t format)
+{
+    bool unmapped = glUnmapNamedBuffer(imm_gl.staging_buffer) == GL_TRUE;
+    if(texture && unmapped)
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, imm_gl.staging_buffer);
+        glTextureSubImage2D(texture, 0, 0, 0, width, height, format == texture_format_r8 ? GL_RED : GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &imm_gl.staging_buffer);
+    imm_memory_untrack(memory_tag_gpu_buffer, imm_gl.staging_size);
+    imm_gl.staging_buffer = 0;
+    imm_gl.staging_size = 0;
+}
+
+// TODO: test if glBufferSubData us faster than glMapBuffer
+void imm_gl_buffer_upload(imm_window_t *window, imm_render_list_t *list)
+{
+    imm_gl_make_current(window);
+    
+    // NOTE: only the used part of the range of every pipeline is written
+    u64 vertex_size = 0;
+    for(u32 pipeline = 0; pipeline < imm_gl.layout_count; ++pipeline)
+    {
+        if(list->streams[pipeline].count)
+        {
+            vertex_size = imm_gl.vertex_offsets[pipeline] + (u64)list->streams[pipeline].count * imm_gl.layouts[pipeline].stride;
+        }
+    }
+    u64 opaque_size = (u64)list->opaque_index_count * sizeof(u32);
+    u64 index_size = opaque_size + (u64)list->index_count * sizeof(u32);
+    if(vertex_size)
+    {
+        u8 *vertex_buffer = (u8 *)glMapNamedBufferRange(window->vertex_buffer, 0, vertex_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        for(u32 pipeline = 0; pipeline < imm_gl.layout_count; ++pipeline)
+        {
+            imm_render_stream_t *stream = list->streams + pipeline;
+            memcpy(vertex_buffer + imm_gl.vertex_offsets[pipeline], stream->vertices, (u64)stream->count * imm_gl.layouts[pipeline].stride);
+        }
+        glUnmapNamedBuffer(window->vertex_buffer);
+    }
+    if(index_size)
+    {
+        u8 *index_buffer = (u8 *)glMapNamedBufferRange(window->index_buffer, 0, index_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        memcpy(index_buffer, list->opaque_indices, opaque_size);
+        memcpy(index_buffer + opaque_size, list->indices, list->index_count * sizeof(u32));
+        glUnmapNamedBuffer(window->index_buffer);
+    }
+}
+
+void imm_gl_submit(imm_window_t *window, imm_render_list_t *list)
+{
+    imm_gl_make_current(window);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, window->framebuffer);
+    glViewport(0, 0, window->width, window->height);
+    m4 projection = m4_ortho(0, (f32)list->width, 0, (f32)list->height, 0, 1.0f);
+    for(u32 pipeline = 0; pipeline < imm_gl.layout_count; ++pipeline)
+    {
+        if(imm_gl.programs[pipeline])
+        {
+            glProgramUniformMatrix4fv(imm_gl.programs[pipeline], imm_gl.projection_locations[pipeline], 1, GL_TRUE, (const float *)projection.m);
+        }
+    }
+    glBindTextureUnit(0, list->textures[0]);
+    glBindTextureUnit(1, list->textures[1]);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glDepthMask(GL_TRUE);
+    glClearColor(list->clear_color.x, list->clear_color.y, list->clear_color.z, list->clear_color.w);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glBeginQuery(GL_SAMPLES_PASSED, window->queries[window->query_frame & 1]);
+    
+    // NOTE: without opaque indices the depth test always pass, the depth buffer is clear
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    if(list->opaque_index_count)
+    {
+        glDisable(GL_BLEND);
+        glUseProgram(imm_gl.programs[list->opaque_pipeline]);
+        glBindVertexArray(window->vertex_arrays[list->opaque_pipeline]);
+        glDrawElements(GL_TRIANGLES, list->opaque_index_count, GL_UNSIGNED_INT, 0);
+    }
+    // NOTE: translucent primitives are tested against the opaque ones but never write depth
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    u32 bound = imm_backend_max_pipelines;
+    u32 bound_texture = list->textures[1];
+    for(u32 i = 0; i < list->command_count; ++i)
+    {
+        imm_draw_command_t *command = list->commands + i;
+        if(command->pipeline != bound)
+        {
+            bound = command->pipeline;
+            glUseProgram(imm_gl.programs[bound]);
+            glBindVertexArray(window->vertex_arrays[bound]);
+        }
+        u32 texture = command->texture ? command->texture : list->textures[1];
+        if(texture != bound_texture)
+        {
+            bound_texture = texture;
+            glBindTextureUnit(1, texture);
+        }
+        u64 offset = (list->opaque_index_count + command->index_offset) * sizeof(u32);
+        glDrawElements(GL_TRIANGLES, command->index_count, GL_UNSIGNED_INT, (const void *)offset);
+    }
+    glDepthMask(GL_TRUE);
+    
+    glEndQuery(GL_SAMPLES_PASSED);
+    
+    // NOTE: the samples of the frame are read one frame later so the query never stalls
+    window->query_frame++;
+    unsigned int previous = window->queries[window->query_frame & 1];
+    int available = 0;
+    if(window->query_frame > 1)
+    {
+        glGetQueryObjectiv(previous, GL_QUERY_RESULT_AVAILABLE, &available);
+    }
+    if(available)
+    {
+        GLuint64 samples = 0;
+        glGetQueryObjectui64v(previous, GL_QUERY_RESULT, &samples);
+        window->samples = samples;
+    }
+}
+
+void imm_gl_present(imm_window_t *window)
+{
+    if(window->framebuffer)
+    {
+        return;
+    }
+    imm_gl_make_current(window);
+    SDL_GL_SwapWindow(window->window);
+}
+
+void imm_gl_read_pixels(imm_window_t *window, u8 *pixels)
+{
+    imm_gl_make_current(window);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, window->framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, window->width, window->height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+    // NOTE: gl rows start at the bottom
+    u32 *rows = (u32 *)pixels;
+    for(s32 y = 0; y < window->height / 2; ++y)
+    {
+        u32 *top = rows + (u64)y * window->width;
+        u32 *bottom = rows + (u64)(window->height - 1 - y) * window->width;
+        for(s32 x = 0; x < window->width; ++x)
+        {
+            u32 pixel = top[x];
+            top[x] = bottom[x];
+            bottom[x] = pixel;
+        }
+    }
+}
+
+static imm_backend_t imm_backend_gl =
+{
+    "opengl 4.5",
+    imm_gl_window_open,
+    imm_gl_window_close,
+    imm_gl_vertex_layout,
+    imm_gl_program_load,
+    imm_gl_texture_create,
+    imm_gl_texture_update,
+    imm_gl_texture_destroy,
+    imm_gl_texture_staging_begin,
+    imm_gl_texture_staging_end,
+    imm_gl_buffer_upload,
+    imm_gl_submit,
+    imm_gl_present,
+    imm_gl_read_pixels,
+};
+
+#endif // IMM_BACKEND_GL_H
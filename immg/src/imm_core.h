@@ -3,9 +3,20 @@
 
 #include "imm_types.h"
 #include <math.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #define PI (3.14159265359f)
 
+// NOTE: lets a function use instructions above the baseline of the build,
+// the caller is responsible of checking the cpu support at runtime
+#ifdef _MSC_VER
+#define IMM_TARGET(x)
+#else
+#define IMM_TARGET(x) __attribute__((target(x)))
+#endif
+
 inline u32 u32_min_2(u32 u0, u32 u1)
 {
     return u0 < u1 ? u0 : u1;
@@ -16,6 +27,18 @@ inline u32 u32_max_2(u32 u0, u32 u1)
     return u0 > u1 ? u0 : u1;
 }
 
+// NOTE: index of the lowest set bit, v must not be 0
+inline u32 u32_ctz(u32 v)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, v);
+    return (u32)index;
+#else
+    return (u32)__builtin_ctz(v);
+#endif
+}
+
 inline f32 f32_infinity()
 {
     f32 result = INFINITY;
@@ -0,0 +1,249 @@
+#ifndef IMM_HIT_H
+#define IMM_HIT_H
+
+#include <SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include "imm_math.h"
+
+// NOTE: spatial index to resolve which interactive rect is under the mouse.
+// Every frame the widgets register their rects, at the end of the frame a uniform
+// grid is build with a counting sort and the next frame query it. Rects that cover
+// a lot of cells (panels, backgrounds) go to a separate list so the grid stays small.
+// When the cell references are full the rest of the items also go to that list, they
+// are slower to query but still hit
+
+#define imm_hit_max_items KB(16)
+#define imm_hit_max_refs KB(64)
+#define imm_hit_max_cells_x 128
+#define imm_hit_max_cells_y 128
+#define imm_hit_cell_size 64
+#define imm_hit_large_item_cells 16
+
+struct imm_hit_item_t
+{
+    rect2d rect;
+    u32 id;
+    s32 z;
+    // NOTE: set by imm_hit_build, false for the items of the large list
+    bool in_grid;
+};
+
+struct imm_hit_stats_t
+{
+    u32 item_count;
+    u32 large_count;
+    u32 ref_count;
+    // NOTE: items in the large list only because the cell references were full
+    u32 overflow_count;
+    u64 build_ticks;
+    u64 query_ticks;
+    u64 query_count;
+    u64 query_tested;
+};
+
+struct imm_hit_grid_t
+{
+    imm_hit_item_t items[imm_hit_max_items];
+    u32 item_count;
+
+    u32 cells_x;
+    u32 cells_y;
+    u32 cell_start[(imm_hit_max_cells_x * imm_hit_max_cells_y) + 1];
+    u32 cell_items[imm_hit_max_refs];
+
+    u32 large_items[imm_hit_max_items];
+    u32 large_count;
+
+    bool built;
+    imm_hit_stats_t stats;
+};
+
+void imm_hit_begin(imm_hit_grid_t *grid, u32 width, u32 height)
+{
+    grid->item_count = 0;
+    grid->large_count = 0;
+    grid->built = false;
+    grid->cells_x = u32_min_2((width + imm_hit_cell_size - 1) / imm_hit_cell_size, imm_hit_max_cells_x);
+    grid->cells_y = u32_min_2((height + imm_hit_cell_size - 1) / imm_hit_cell_size, imm_hit_max_cells_y);
+}
+
+// NOTE: the registration order is the draw order, with the same z the last rect wins
+void imm_hit_register(imm_hit_grid_t *grid, u32 id, rect2d rect, s32 z, rect2d clip)
+{
+    rect = rect2d_intersection(rect, clip);
+    if((rect.min.x >= rect.max.x) || (rect.min.y >= rect.max.y) || (grid->item_count >= imm_hit_max_items))
+    {
+        return;
+    }
+    imm_hit_item_t *item = grid->items + grid->item_count++;
+    item->rect = rect;
+    item->id = id;
+    item->z = z;
+    grid->built = false;
+}
+
+inline void imm_hit_cell_range(imm_hit_grid_t *grid, rect2d rect, u32 *min_x, u32 *min_y, u32 *max_x, u32 *max_y)
+{
+    f32 inv_cell = 1.0f / (f32)imm_hit_cell_size;
+    *min_x = (u32)f32_max_2(rect.min.x * inv_cell, 0);
+    *min_y = (u32)f32_max_2(rect.min.y * inv_cell, 0);
+    *max_x = (u32)f32_max_2(rect.max.x * inv_cell, 0);
+    *max_y = (u32)f32_max_2(rect.max.y * inv_cell, 0);
+    *min_x = u32_min_2(*min_x, grid->cells_x - 1);
+    *min_y = u32_min_2(*min_y, grid->cells_y - 1);
+    *max_x = u32_min_2(*max_x, grid->cells_x - 1);
+    *max_y = u32_min_2(*max_y, grid->cells_y - 1);
+}
+
+void imm_hit_build(imm_hit_grid_t *grid)
+{
+    u64 start = SDL_GetPerformanceCounter();
+
+    u32 cell_count = grid->cells_x * grid->cells_y;
+    memset(grid->cell_start, 0, (cell_count + 1) * sizeof(u32));
+    grid->large_count = 0;
+
+    if(cell_count == 0)
+    {
+        grid->built = true;
+        return;
+    }
+
+    // NOTE: first pass count the items of every cell
+    u32 ref_count = 0;
+    u32 overflow_count = 0;
+    for(u32 i = 0; i < grid->item_count; ++i)
+    {
+        imm_hit_item_t *item = grid->items + i;
+        u32 min_x, min_y, max_x, max_y;
+        imm_hit_cell_range(grid, item->rect, &min_x, &min_y, &max_x, &max_y);
+        u32 covered = (max_x - min_x + 1) * (max_y - min_y + 1);
+        bool overflow = (ref_count + covered) > imm_hit_max_refs;
+        item->in_grid = (covered <= imm_hit_large_item_cells) && !overflow;
+        if(!item->in_grid)
+        {
+            overflow_count += (covered <= imm_hit_large_item_cells) ? 1 : 0;
+            grid->large_items[grid->large_count++] = i;
+            continue;
+        }
+        ref_count += covered;
+        for(u32 y = min_y; y <= max_y; ++y)
+        {
+            for(u32 x = min_x; x <= max_x; ++x)
+            {
+                grid->cell_start[(y * grid->cells_x) + x + 1]++;
+            }
+        }
+    }
+
+    for(u32 i = 0; i < cell_count; ++i)
+    {
+        grid->cell_start[i + 1] += grid->cell_start[i];
+    }
+
+    // NOTE: second pass fill the cells, cell_start is used as the write cursor and
+    // restore after, so the item of a cell keep the registration order
+    for(u32 i = 0; i < grid->item_count; ++i)
+    {
+        if(!grid->items[i].in_grid)
+        {
+            continue;
+        }
+        u32 min_x, min_y, max_x, max_y;
+        imm_hit_cell_range(grid, grid->items[i].rect, &min_x, &min_y, &max_x, &max_y);
+        for(u32 y = min_y; y <= max_y; ++y)
+        {
+            for(u32 x = min_x; x <= max_x; ++x)
+            {
+                u32 *cursor = grid->cell_start + (y * grid->cells_x) + x;
+                grid->cell_items[(*cursor)++] = i;
+            }
+        }
+    }
+    for(u32 i = cell_count; i > 0; --i)
+    {
+        grid->cell_start[i] = grid->cell_start[i - 1];
+    }
+    grid->cell_start[0] = 0;
+
+    grid->built = true;
+    grid->stats.item_count = grid->item_count;
+    grid->stats.large_count = grid->large_count;
+    grid->stats.ref_count = ref_count;
+    grid->stats.overflow_count = overflow_count;
+    grid->stats.build_ticks = SDL_GetPerformanceCounter() - start;
+}
+
+inline bool imm_hit_item_contains(imm_hit_item_t *item, v2 point)
+{
+    return (point.x >= item->rect.min.x) && (point.x < item->rect.max.x) &&
+           (point.y >= item->rect.min.y) && (point.y < item->rect.max.y);
+}
+
+// NOTE: return the id of the topmost rect under the point or 0
+u32 imm_hit_test(imm_hit_grid_t *grid, v2 point)
+{
+    if(!grid->built)
+    {
+        imm_hit_build(grid);
+    }
+    if((grid->cells_x == 0) || (grid->cells_y == 0) || (point.x < 0) || (point.y < 0))
+    {
+        return 0;
+    }
+
+    u64 start = SDL_GetPerformanceCounter();
+
+    s32 best = -1;
+    u32 tested = 0;
+    #define imm_hit_consider(index) \
+    { \
+        imm_hit_item_t *item = grid->items + (index); \
+        tested++; \
+        if(imm_hit_item_contains(item, point) && \
+           ((best < 0) || (item->z > grid->items[best].z) || ((item->z == grid->items[best].z) && ((s32)(index) > best)))) \
+        { \
+            best = (s32)(index); \
+        } \
+    }
+
+    u32 cell_x = (u32)(point.x / imm_hit_cell_size);
+    u32 cell_y = (u32)(point.y / imm_hit_cell_size);
+    if((cell_x < grid->cells_x) && (cell_y < grid->cells_y))
+    {
+        u32 cell = (cell_y * grid->cells_x) + cell_x;
+        for(u32 i = grid->cell_start[cell]; i < grid->cell_start[cell + 1]; ++i)
+        {
+            imm_hit_consider(grid->cell_items[i]);
+        }
+    }
+    for(u32 i = 0; i < grid->large_count; ++i)
+    {
+        imm_hit_consider(grid->large_items[i]);
+    }
+
+    #undef imm_hit_consider
+
+    grid->stats.query_ticks += SDL_GetPerformanceCounter() - start;
+    grid->stats.query_count++;
+    grid->stats.query_tested += tested;
+
+    return best >= 0 ? grid->items[best].id : 0;
+}
+
+void imm_hit_stats_print(imm_hit_grid_t *grid)
+{
+    imm_hit_stats_t *stats = &grid->stats;
+    f64 frequency = (f64)SDL_GetPerformanceFrequency();
+    f64 query_us = stats->query_count ? ((f64)stats->query_ticks * 1000000.0 / frequency) / (f64)stats->query_count : 0;
+    f64 tested = stats->query_count ? (f64)stats->query_tested / (f64)stats->query_count : 0;
+    printf("[hit]: %u items (%u large, %u over the cell refs) %u cell refs, build %.3f us, query %.3f us avg testing %.1f items\n",
+           stats->item_count, stats->large_count, stats->overflow_count, stats->ref_count,
+           (f64)stats->build_ticks * 1000000.0 / frequency, query_us, tested);
+    stats->query_ticks = 0;
+    stats->query_count = 0;
+    stats->query_tested = 0;
+}
+
+#endif // IMM_HIT_H
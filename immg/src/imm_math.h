@@ -3,7 +3,6 @@
 
 #include "imm_core.h"
 
-// TODO: implement v2 operations and functions
 struct v2
 {
     f32 x, y;
@@ -58,6 +57,55 @@ inline v2 operator*(v2 a, f32 v)
     return result;
 }
 
+inline v2 operator*(f32 v, v2 a)
+{
+    v2 result = {a.x * v, a.y * v};
+    return result;
+}
+
+inline v2 operator/(v2 a, f32 v)
+{
+    v2 result = {a.x / v, a.y / v};
+    return result;
+}
+
+inline v2 operator-(v2 a)
+{
+    v2 result = {-a.x, -a.y};
+    return result;
+}
+
+inline f32 v2_dot(v2 a, v2 b)
+{
+    f32 result = (a.x * b.x) + (a.y * b.y);
+    return result;
+}
+
+inline f32 v2_length_sqr(v2 a)
+{
+    f32 result = (a.x * a.x) + (a.y * a.y);
+    return result;
+}
+
+inline f32 v2_length(v2 a)
+{
+    f32 result = f32_sqrt((a.x * a.x) + (a.y * a.y));
+    return result;
+}
+
+inline v2 v2_normalize(v2 v)
+{
+    v2 result = v / v2_length(v);
+    return result;
+}
+
+// NOTE: counter clockwise perpendicular
+inline v2 v2_perp(v2 v)
+{
+    v2 result = {-v.y, v.x};
+    return result;
+}
+
 inline v2 v2_lerp(v2 a, v2 b, f32 t)
 {
     v2 result = a * (1-t) + b * t;
@@ -0,0 +1,210 @@
+#ifndef IMM_MEMORY_H
+#define IMM_MEMORY_H
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "imm_core.h"
+
+// NOTE: every allocation of the gui goes through here with a tag, so the live bytes,
+// the peak and the number of allocations of every subsystem can be asked at runtime.
+// Memory that is not allocated here (static buffers, GPU objects) is reported with
+// imm_memory_track and imm_memory_untrack so the totals cover all the gui
+
+enum imm_memory_tag_t
+{
+    memory_tag_atlas,
+    memory_tag_vertex,
+    memory_tag_index,
+    memory_tag_texture,
+    memory_tag_tiles,
+    memory_tag_state,
+    memory_tag_arena,
+    memory_tag_file_io,
+    memory_tag_text,
+    memory_tag_thumbnails,
+    memory_tag_gpu_buffer,
+    memory_tag_gpu_texture,
+
+    memory_tag_count,
+};
+
+static const char *imm_memory_tag_names[memory_tag_count] =
+{
+    "atlas",
+    "vertex",
+    "index",
+    "texture",
+    "tiles",
+    "state",
+    "arena",
+    "file_io",
+    "text",
+    "thumbnails",
+    "gpu_buffer",
+    "gpu_texture",
+};
+
+struct imm_memory_stats_t
+{
+    u64 live;
+    u64 peak;
+    u64 live_count;
+    u64 total_count;
+    // NOTE: 0 means no budget
+    u64 budget;
+    bool over_budget;
+};
+
+// NOTE: the header keeps the size and the tag of the allocation, its size keeps
+// the memory returned to the caller aligned to 16 bytes
+struct imm_memory_header_t
+{
+    u64 size;
+    u32 tag;
+    u32 magic;
+};
+
+#define imm_memory_magic 0x4D4D4D49 // NOTE: 'IMMM'
+
+static imm_memory_stats_t imm_memory_stats[memory_tag_count];
+// NOTE: the glyph and io workers allocate too, the lock only protects the counters
+static SDL_SpinLock imm_memory_lock;
+
+void imm_memory_track(imm_memory_tag_t tag, u64 size)
+{
+    SDL_AtomicLock(&imm_memory_lock);
+    imm_memory_stats_t *stats = imm_memory_stats + tag;
+    stats->live += size;
+    stats->live_count++;
+    stats->total_count++;
+    if(stats->live > stats->peak)
+    {
+        stats->peak = stats->live;
+    }
+    bool over_budget = stats->budget && (stats->live > stats->budget);
+    bool report = over_budget && !stats->over_budget;
+    stats->over_budget = over_budget;
+    u64 live = stats->live;
+    u64 budget = stats->budget;
+    SDL_AtomicUnlock(&imm_memory_lock);
+
+    if(report)
+    {
+        printf("[memory-error]: %s is over budget %llu/%llu bytes\n", imm_memory_tag_names[tag],
+               (unsigned long long)live, (unsigned long long)budget);
+    }
+}
+
+void imm_memory_untrack(imm_memory_tag_t tag, u64 size)
+{
+    SDL_AtomicLock(&imm_memory_lock);
+    imm_memory_stats_t *stats = imm_memory_stats + tag;
+    stats->live -= size;
+    stats->live_count--;
+    stats->over_budget = stats->budget && (stats->live > stats->budget);
+    SDL_AtomicUnlock(&imm_memory_lock);
+}
+
+void *imm_alloc(u64 size, imm_memory_tag_t tag)
+{
+    imm_memory_header_t *header = (imm_memory_header_t *)malloc(sizeof(imm_memory_header_t) + size);
+    if(!header)
+    {
+        printf("[memory-error]: fail to allocate %llu bytes for %s\n", (unsigned long long)size, imm_memory_tag_names[tag]);
+        return 0;
+    }
+    header->size = size;
+    header->tag = tag;
+    header->magic = imm_memory_magic;
+    imm_memory_track(tag, size);
+    return header + 1;
+}
+
+void *imm_alloc_zero(u64 size, imm_memory_tag_t tag)
+{
+    void *result = imm_alloc(size, tag);
+    if(result)
+    {
+        memset(result, 0, size);
+    }
+    return result;
+}
+
+void imm_free(void *memory)
+{
+    if(!memory)
+    {
+        return;
+    }
+    imm_memory_header_t *header = (imm_memory_header_t *)memory - 1;
+    assert(header->magic == imm_memory_magic);
+    header->magic = 0;
+    imm_memory_untrack((imm_memory_tag_t)header->tag, header->size);
+    free(header);
+}
+
+void imm_memory_set_budget(imm_memory_tag_t tag, u64 budget)
+{
+    SDL_AtomicLock(&imm_memory_lock);
+    imm_memory_stats[tag].budget = budget;
+    SDL_AtomicUnlock(&imm_memory_lock);
+}
+
+imm_memory_stats_t imm_memory_get(imm_memory_tag_t tag)
+{
+    SDL_AtomicLock(&imm_memory_lock);
+    imm_memory_stats_t result = imm_memory_stats[tag];
+    SDL_AtomicUnlock(&imm_memory_lock);
+    return result;
+}
+
+// NOTE: live bytes of every tag, with gpu true only the gpu tags
+u64 imm_memory_total(bool gpu)
+{
+    u64 result = 0;
+    SDL_AtomicLock(&imm_memory_lock);
+    for(u32 tag = 0; tag < memory_tag_count; ++tag)
+    {
+        bool is_gpu = (tag == memory_tag_gpu_buffer) || (tag == memory_tag_gpu_texture);
+        if(is_gpu == gpu)
+        {
+            result += imm_memory_stats[tag].live;
+        }
+    }
+    SDL_AtomicUnlock(&imm_memory_lock);
+    return result;
+}
+
+// NOTE: allocations made since the start of every tag, the difference between two
+// calls is the number of allocations in between
+u64 imm_memory_allocation_count()
+{
+    u64 result = 0;
+    SDL_AtomicLock(&imm_memory_lock);
+    for(u32 tag = 0; tag < memory_tag_count; ++tag)
+    {
+        result += imm_memory_stats[tag].total_count;
+    }
+    SDL_AtomicUnlock(&imm_memory_lock);
+    return result;
+}
+
+void imm_memory_dump()
+{
+    printf("[memory]: %-12s %12s %12s %8s %10s %12s\n", "tag", "live", "peak", "count", "total", "budget");
+    for(u32 tag = 0; tag < memory_tag_count; ++tag)
+    {
+        imm_memory_stats_t stats = imm_memory_get((imm_memory_tag_t)tag);
+        printf("[memory]: %-12s %12llu %12llu %8llu %10llu %12llu%s\n", imm_memory_tag_names[tag],
+               (unsigned long long)stats.live, (unsigned long long)stats.peak,
+               (unsigned long long)stats.live_count, (unsigned long long)stats.total_count,
+               (unsigned long long)stats.budget, stats.over_budget ? " OVER" : "");
+    }
+    printf("[memory]: cpu %llu bytes, gpu %llu bytes\n",
+           (unsigned long long)imm_memory_total(false), (unsigned long long)imm_memory_total(true));
+}
+
+#endif // IMM_MEMORY_H
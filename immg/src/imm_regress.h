@@ -0,0 +1,172 @@
+#ifndef IMM_REGRESS_H
+#define IMM_REGRESS_H
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stb_image_write.h>
+#include "imm_core.h"
+#include "imm_memory.h"
+#include "imm_texture.h"
+
+// NOTE: regression of scripted scenes drawn in a hidden window. Every scene is drawn
+// for a few frames to warm the caches, then timed for more frames. The last frame is
+// read back and compared with the golden image of the scene, the goldens are written
+// with --regress --update on the machine that runs the tests. A scene fails when its
+// image is different, when the median cpu time of its frames is over its budget or
+// when a frame allocates more than its budget. A scene without golden only skips the
+// image compare, the goldens depend on the driver so a fresh checkout has none
+
+// NOTE: a channel can differ this much before the pixel counts as different, the
+// rasterization of the edges changes a bit between drivers
+#define imm_regress_channel_tolerance 8
+// NOTE: different pixels allowed, in pixels per million
+#define imm_regress_max_different_ppm 500
+#define imm_regress_warmup_frames 4
+#define imm_regress_frames 32
+
+struct imm_regress_scene_t
+{
+    const char *name;
+    void (*push)(void *user);
+    f32 max_frame_ms;
+    u32 max_allocations;
+};
+
+struct imm_regress_result_t
+{
+    f64 frame_ms;
+    u64 allocations;
+    u32 different_pixels;
+    u32 max_difference;
+    bool has_golden;
+    bool passed;
+};
+
+f64 imm_regress_median(f64 *values, u32 count)
+{
+    for(u32 i = 1; i < count; ++i)
+    {
+        f64 value = values[i];
+        u32 j = i;
+        for(; j > 0 && values[j - 1] > value; --j)
+        {
+            values[j] = values[j - 1];
+        }
+        values[j] = value;
+    }
+    return count ? values[count / 2] : 0;
+}
+
+// NOTE: only the color is compared, the alpha of the framebuffer is not shown. The
+// different pixels are painted red in diff, the others are a dark copy of pixels
+void imm_regress_compare(u8 *pixels, imm_texture_t *golden, u8 *diff, imm_regress_result_t *result)
+{
+    result->different_pixels = 0;
+    result->max_difference = 0;
+    for(u32 y = 0; y < golden->height; ++y)
+    {
+        u8 *expected = (u8 *)golden->pixels + (u64)y * golden->pitch;
+        u8 *actual = pixels + (u64)y * golden->width * 4;
+        u8 *out = diff + (u64)y * golden->width * 4;
+        for(u32 x = 0; x < golden->width; ++x)
+        {
+            u32 difference = 0;
+            for(u32 c = 0; c < 3; ++c)
+            {
+                u32 d = (u32)abs((s32)actual[x * 4 + c] - (s32)expected[x * 4 + c]);
+                difference = u32_max_2(difference, d);
+            }
+            result->max_difference = u32_max_2(result->max_difference, difference);
+            bool different = difference > imm_regress_channel_tolerance;
+            result->different_pixels += different ? 1 : 0;
+            out[x * 4 + 0] = different ? 255 : actual[x * 4 + 0] / 4;
+            out[x * 4 + 1] = different ? 0 : actual[x * 4 + 1] / 4;
+            out[x * 4 + 2] = different ? 0 : actual[x * 4 + 2] / 4;
+            out[x * 4 + 3] = 255;
+        }
+    }
+}
+
+// NOTE: check the frame of the scene against its golden in directory, or replace the
+// golden with update. On failure the frame and the diff are written next to the golden
+bool imm_regress_check(imm_regress_scene_t *scene, imm_regress_result_t *result, u8 *pixels, u32 width, u32 height,
+                       const char *directory, bool update)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.bmp", directory, scene->name);
+
+    result->passed = true;
+    result->has_golden = false;
+    result->different_pixels = 0;
+    result->max_difference = 0;
+    if(update)
+    {
+        if(!stbi_write_bmp(path, (int)width, (int)height, 4, pixels))
+        {
+            printf("[regress-error]: could not write %s\n", path);
+            result->passed = false;
+        }
+    }
+    else
+    {
+        u64 mtime = 0;
+        u64 size = 0;
+        imm_texture_t golden = {};
+        if(imm_file_stat(path, &mtime, &size))
+        {
+            golden = imm_texture_load_bmp(path);
+        }
+        result->has_golden = golden.pixels != 0;
+        if(!result->has_golden)
+        {
+            printf("[regress]: %s has no golden %s, the image is not compared, make it with --regress --update\n", scene->name, path);
+        }
+        else if(golden.width != width || golden.height != height)
+        {
+            printf("[regress-error]: %s golden is %ux%u, the frame is %ux%u\n", scene->name, golden.width, golden.height, width, height);
+            result->passed = false;
+        }
+        else
+        {
+            u8 *diff = (u8 *)imm_alloc((u64)width * height * 4, memory_tag_texture);
+            imm_regress_compare(pixels, &golden, diff, result);
+            u64 max_different = (u64)width * height * imm_regress_max_different_ppm / 1000000;
+            if(result->different_pixels > max_different)
+            {
+                printf("[regress-error]: %s has %u different pixels, %llu allowed, max difference %u\n", scene->name,
+                       result->different_pixels, (unsigned long long)max_different, result->max_difference);
+                result->passed = false;
+
+                char out_path[512];
+                snprintf(out_path, sizeof(out_path), "%s/%s_actual.bmp", directory, scene->name);
+                stbi_write_bmp(out_path, (int)width, (int)height, 4, pixels);
+                snprintf(out_path, sizeof(out_path), "%s/%s_diff.bmp", directory, scene->name);
+                stbi_write_bmp(out_path, (int)width, (int)height, 4, diff);
+            }
+            imm_free(diff);
+        }
+        imm_texture_free(&golden);
+    }
+
+    if(result->frame_ms > scene->max_frame_ms)
+    {
+        printf("[regress-error]: %s takes %.3f ms per frame, the budget is %.3f ms\n", scene->name, result->frame_ms, scene->max_frame_ms);
+        result->passed = false;
+    }
+    if(result->allocations > scene->max_allocations)
+    {
+        printf("[regress-error]: %s makes %llu allocations in a frame, the budget is %u\n", scene->name,
+               (unsigned long long)result->allocations, scene->max_allocations);
+        result->passed = false;
+    }
+
+    const char *status = update ? "updated" : (!result->passed ? "FAILED" : (result->has_golden ? "passed" : "no golden"));
+    printf("[regress]: %-10s %s %.3f ms (%.3f), %llu allocations (%u), %u different pixels\n", scene->name,
+           status, result->frame_ms, scene->max_frame_ms,
+           (unsigned long long)result->allocations, scene->max_allocations, result->different_pixels);
+    return result->passed;
+}
+
+#endif // IMM_REGRESS_H
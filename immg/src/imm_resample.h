@@ -0,0 +1,492 @@
+#ifndef IMM_RESAMPLE_H
+#define IMM_RESAMPLE_H
+
+#include <SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+#include "imm_math.h"
+#include "imm_memory.h"
+#include "imm_thread.h"
+#include "imm_texture.h"
+
+// NOTE: separable resampling of rgba8 images. Every output pixel of an axis reads
+// the same number of source pixels (the window is clamped inside the image and the
+// weights padded with zeros), so the kernels are branch free loops over the taps.
+// The rows are filtered first into a float band and then the columns of the band,
+// the output is processed in bands of rows that can run in parallel
+
+enum imm_resample_filter_t
+{
+    resample_filter_box,
+    resample_filter_bilinear,
+    resample_filter_lanczos3,
+
+    resample_filter_count,
+};
+
+static const char *imm_resample_filter_names[resample_filter_count] =
+{
+    "box",
+    "bilinear",
+    "lanczos3",
+};
+
+// NOTE: first is the first source pixel of every output pixel, the weights are
+// tap_count per output pixel
+struct imm_resample_axis_t
+{
+    u32 *first;
+    f32 *weights;
+    u32 tap_count;
+    u32 count;
+};
+
+struct imm_resample_t
+{
+    imm_texture_t *dst;
+    imm_texture_t *src;
+    imm_resample_axis_t x;
+    imm_resample_axis_t y;
+};
+
+#define imm_resample_band_rows 32
+
+inline f32 imm_resample_sinc(f32 x)
+{
+    if(x == 0)
+    {
+        return 1.0f;
+    }
+    x *= 3.14159265f;
+    return sinf(x) / x;
+}
+
+inline f32 imm_resample_filter_support(imm_resample_filter_t filter)
+{
+    return filter == resample_filter_box ? 0.5f : (filter == resample_filter_bilinear ? 1.0f : 3.0f);
+}
+
+inline f32 imm_resample_filter_weight(imm_resample_filter_t filter, f32 x)
+{
+    x = x < 0 ? -x : x;
+    switch(filter)
+    {
+    case resample_filter_box: return x <= 0.5f ? 1.0f : 0.0f;
+    case resample_filter_bilinear: return x < 1.0f ? 1.0f - x : 0.0f;
+    case resample_filter_lanczos3: return x < 3.0f ? imm_resample_sinc(x) * imm_resample_sinc(x / 3.0f) : 0.0f;
+    default: return 0.0f;
+    }
+}
+
+// NOTE: when downscaling the filter is stretched to cover all the source pixels
+// of one output pixel
+void imm_resample_axis_init(imm_resample_axis_t *axis, u32 src_size, u32 dst_size, imm_resample_filter_t filter)
+{
+    f32 scale = (f32)src_size / (f32)dst_size;
+    f32 filter_scale = scale > 1.0f ? scale : 1.0f;
+    f32 support = imm_resample_filter_support(filter) * filter_scale;
+    u32 tap_count = u32_min_2((u32)ceilf(support * 2.0f) + 1, src_size);
+
+    axis->count = dst_size;
+    axis->tap_count = tap_count;
+    axis->first = (u32 *)imm_alloc(dst_size * sizeof(u32), memory_tag_texture);
+    axis->weights = (f32 *)imm_alloc((u64)dst_size * tap_count * sizeof(f32), memory_tag_texture);
+
+    for(u32 i = 0; i < dst_size; ++i)
+    {
+        f32 center = ((f32)i + 0.5f) * scale - 0.5f;
+        s32 first = (s32)ceilf(center - support);
+        first = first < 0 ? 0 : first;
+        first = (first + (s32)tap_count) > (s32)src_size ? (s32)(src_size - tap_count) : first;
+
+        f32 *weights = axis->weights + (u64)i * tap_count;
+        f32 sum = 0;
+        for(u32 t = 0; t < tap_count; ++t)
+        {
+            weights[t] = imm_resample_filter_weight(filter, ((f32)(first + (s32)t) - center) / filter_scale);
+            sum += weights[t];
+        }
+        if(sum == 0)
+        {
+            // NOTE: no source pixel under the filter, use the nearest one
+            s32 nearest = (s32)(center + 0.5f) - first;
+            nearest = nearest < 0 ? 0 : (nearest >= (s32)tap_count ? (s32)tap_count - 1 : nearest);
+            weights[nearest] = 1.0f;
+            sum = 1.0f;
+        }
+        for(u32 t = 0; t < tap_count; ++t)
+        {
+            weights[t] /= sum;
+        }
+        axis->first[i] = (u32)first;
+    }
+}
+
+void imm_resample_axis_free(imm_resample_axis_t *axis)
+{
+    imm_free(axis->first);
+    imm_free(axis->weights);
+    axis->first = 0;
+    axis->weights = 0;
+}
+
+//
+// resample kernels
+//
+// NOTE: the row kernels filter one source row into dst_width float pixels, the column
+// kernels filter tap_count float rows of the band into one output row
+
+void imm_resample_row_scalar(f32 *dst, u8 *src, imm_resample_axis_t *axis)
+{
+    u32 tap_count = axis->tap_count;
+    for(u32 i = 0; i < axis->count; ++i)
+    {
+        u8 *pixels = src + (u64)axis->first[i] * 4;
+        f32 *weights = axis->weights + (u64)i * tap_count;
+        f32 sum[4] = {};
+        for(u32 t = 0; t < tap_count; ++t)
+        {
+            for(u32 c = 0; c < 4; ++c)
+            {
+                sum[c] += (f32)pixels[t * 4 + c] * weights[t];
+            }
+        }
+        memcpy(dst + i * 4, sum, sizeof(sum));
+    }
+}
+
+void imm_resample_column_scalar(u8 *dst, f32 *rows, u32 row_stride, f32 *weights, u32 tap_count, u32 count)
+{
+    for(u32 x = 0; x < count; ++x)
+    {
+        f32 sum = 0;
+        for(u32 t = 0; t < tap_count; ++t)
+        {
+            sum += rows[(u64)t * row_stride + x] * weights[t];
+        }
+        dst[x] = sum <= 0 ? 0 : (sum >= 255.0f ? 255 : (u8)(sum + 0.5f));
+    }
+}
+
+inline __m128 imm_rgba_to_ps(u8 *pixel)
+{
+    s32 value;
+    memcpy(&value, pixel, sizeof(value));
+    __m128i zero = _mm_setzero_si128();
+    __m128i rgba = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(value), zero), zero);
+    return _mm_cvtepi32_ps(rgba);
+}
+
+void imm_resample_row_sse2(f32 *dst, u8 *src, imm_resample_axis_t *axis)
+{
+    u32 tap_count = axis->tap_count;
+    for(u32 i = 0; i < axis->count; ++i)
+    {
+        u8 *pixels = src + (u64)axis->first[i] * 4;
+        f32 *weights = axis->weights + (u64)i * tap_count;
+        __m128 sum = _mm_setzero_ps();
+        for(u32 t = 0; t < tap_count; ++t)
+        {
+            sum = _mm_add_ps(sum, _mm_mul_ps(imm_rgba_to_ps(pixels + t * 4), _mm_set1_ps(weights[t])));
+        }
+        _mm_storeu_ps(dst + i * 4, sum);
+    }
+}
+
+// NOTE: 4 output pixels per iteration, the rounding and the clamp come from the packs
+void imm_resample_column_sse2(u8 *dst, f32 *rows, u32 row_stride, f32 *weights, u32 tap_count, u32 count)
+{
+    u32 x = 0;
+    for(; (x + 16) <= count; x += 16)
+    {
+        __m128 sum_0 = _mm_setzero_ps();
+        __m128 sum_1 = _mm_setzero_ps();
+        __m128 sum_2 = _mm_setzero_ps();
+        __m128 sum_3 = _mm_setzero_ps();
+        for(u32 t = 0; t < tap_count; ++t)
+        {
+            f32 *row = rows + (u64)t * row_stride + x;
+            __m128 weight = _mm_set1_ps(weights[t]);
+            sum_0 = _mm_add_ps(sum_0, _mm_mul_ps(_mm_loadu_ps(row + 0), weight));
+            sum_1 = _mm_add_ps(sum_1, _mm_mul_ps(_mm_loadu_ps(row + 4), weight));
+            sum_2 = _mm_add_ps(sum_2, _mm_mul_ps(_mm_loadu_ps(row + 8), weight));
+            sum_3 = _mm_add_ps(sum_3, _mm_mul_ps(_mm_loadu_ps(row + 12), weight));
+        }
+        __m128i low = _mm_packs_epi32(_mm_cvtps_epi32(sum_0), _mm_cvtps_epi32(sum_1));
+        __m128i high = _mm_packs_epi32(_mm_cvtps_epi32(sum_2), _mm_cvtps_epi32(sum_3));
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(low, high));
+    }
+    for(; x < count; x += 4)
+    {
+        __m128 sum = _mm_setzero_ps();
+        for(u32 t = 0; t < tap_count; ++t)
+        {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows + (u64)t * row_stride + x), _mm_set1_ps(weights[t])));
+        }
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(sum), _mm_setzero_si128());
+        s32 value = _mm_cvtsi128_si32(_mm_packus_epi16(packed, packed));
+        memcpy(dst + x, &value, sizeof(value));
+    }
+}
+
+// NOTE: two taps per iteration, the low half of the register is the first tap
+IMM_TARGET("avx2")
+void imm_resample_row_avx2(f32 *dst, u8 *src, imm_resample_axis_t *axis)
+{
+    u32 tap_count = axis->tap_count;
+    __m256i spread = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+    for(u32 i = 0; i < axis->count; ++i)
+    {
+        u8 *pixels = src + (u64)axis->first[i] * 4;
+        f32 *weights = axis->weights + (u64)i * tap_count;
+        __m256 sum = _mm256_setzero_ps();
+        u32 t = 0;
+        for(; (t + 2) <= tap_count; t += 2)
+        {
+            __m256 rgba = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i *)(pixels + t * 4))));
+            __m256 weight = _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_castsi128_ps(_mm_loadl_epi64((__m128i *)(weights + t)))), spread);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(rgba, weight));
+        }
+        __m128 result = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+        if(t < tap_count)
+        {
+            result = _mm_add_ps(result, _mm_mul_ps(imm_rgba_to_ps(pixels + t * 4), _mm_set1_ps(weights[t])));
+        }
+        _mm_storeu_ps(dst + i * 4, result);
+    }
+}
+
+// NOTE: 8 output pixels per iteration, the packs work inside the 128 bits lanes so
+// the pixels are put back in order with one permute
+IMM_TARGET("avx2")
+void imm_resample_column_avx2(u8 *dst, f32 *rows, u32 row_stride, f32 *weights, u32 tap_count, u32 count)
+{
+    __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    u32 x = 0;
+    for(; (x + 32) <= count; x += 32)
+    {
+        __m256 sum_0 = _mm256_setzero_ps();
+        __m256 sum_1 = _mm256_setzero_ps();
+        __m256 sum_2 = _mm256_setzero_ps();
+        __m256 sum_3 = _mm256_setzero_ps();
+        for(u32 t = 0; t < tap_count; ++t)
+        {
+            f32 *row = rows + (u64)t * row_stride + x;
+            __m256 weight = _mm256_set1_ps(weights[t]);
+            sum_0 = _mm256_add_ps(sum_0, _mm256_mul_ps(_mm256_loadu_ps(row + 0), weight));
+            sum_1 = _mm256_add_ps(sum_1, _mm256_mul_ps(_mm256_loadu_ps(row + 8), weight));
+            sum_2 = _mm256_add_ps(sum_2, _mm256_mul_ps(_mm256_loadu_ps(row + 16), weight));
+            sum_3 = _mm256_add_ps(sum_3, _mm256_mul_ps(_mm256_loadu_ps(row + 24), weight));
+        }
+        __m256i low = _mm256_packs_epi32(_mm256_cvtps_epi32(sum_0), _mm256_cvtps_epi32(sum_1));
+        __m256i high = _mm256_packs_epi32(_mm256_cvtps_epi32(sum_2), _mm256_cvtps_epi32(sum_3));
+        __m256i packed = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(low, high), order);
+        _mm256_storeu_si256((__m256i *)(dst + x), packed);
+    }
+    imm_resample_column_sse2(dst + x, rows + x, row_stride, weights, tap_count, count - x);
+}
+
+typedef void imm_resample_row_t(f32 *dst, u8 *src, imm_resample_axis_t *axis);
+typedef void imm_resample_column_t(u8 *dst, f32 *rows, u32 row_stride, f32 *weights, u32 tap_count, u32 count);
+
+struct imm_resample_kernels_t
+{
+    const char *name;
+    imm_resample_row_t *row;
+    imm_resample_column_t *column;
+};
+
+enum imm_resample_level_t
+{
+    resample_level_scalar,
+    resample_level_sse2,
+    resample_level_avx2,
+
+    resample_level_count,
+};
+
+static imm_resample_kernels_t imm_resample_kernel_table[resample_level_count] =
+{
+    { "scalar", imm_resample_row_scalar, imm_resample_column_scalar },
+    { "sse2", imm_resample_row_sse2, imm_resample_column_sse2 },
+    { "avx2", imm_resample_row_avx2, imm_resample_column_avx2 },
+};
+
+static imm_resample_kernels_t *imm_resample_kernels = imm_resample_kernel_table + resample_level_sse2;
+static u32 imm_resample_max_level = resample_level_sse2;
+
+void imm_resample_init_kernels()
+{
+    imm_resample_max_level = SDL_HasAVX2() ? resample_level_avx2 : resample_level_sse2;
+    imm_resample_kernels = imm_resample_kernel_table + imm_resample_max_level;
+}
+
+//
+// resample
+//
+
+void imm_resample_begin(imm_resample_t *resample, imm_texture_t *dst, imm_texture_t *src, imm_resample_filter_t filter)
+{
+    resample->dst = dst;
+    resample->src = src;
+    imm_resample_axis_init(&resample->x, src->width, dst->width, filter);
+    imm_resample_axis_init(&resample->y, src->height, dst->height, filter);
+}
+
+void imm_resample_end(imm_resample_t *resample)
+{
+    imm_resample_axis_free(&resample->x);
+    imm_resample_axis_free(&resample->y);
+}
+
+// NOTE: the output rows [first_row, first_row + row_count), the band only filters the
+// source rows those output rows read
+void imm_resample_band(imm_resample_t *resample, u32 first_row, u32 row_count)
+{
+    imm_resample_axis_t *axis_y = &resample->y;
+    u32 src_first = axis_y->first[first_row];
+    u32 src_count = axis_y->first[first_row + row_count - 1] + axis_y->tap_count - src_first;
+    u32 row_stride = resample->dst->width * 4;
+    f32 *band = (f32 *)imm_alloc((u64)src_count * row_stride * sizeof(f32), memory_tag_texture);
+
+    imm_resample_kernels_t *kernels = imm_resample_kernels;
+    for(u32 i = 0; i < src_count; ++i)
+    {
+        u8 *src = (u8 *)resample->src->pixels + (s64)(src_first + i) * resample->src->pitch;
+        kernels->row(band + (u64)i * row_stride, src, &resample->x);
+    }
+    for(u32 y = first_row; y < (first_row + row_count); ++y)
+    {
+        u8 *dst = (u8 *)resample->dst->pixels + (s64)y * resample->dst->pitch;
+        f32 *rows = band + (u64)(axis_y->first[y] - src_first) * row_stride;
+        kernels->column(dst, rows, row_stride, axis_y->weights + (u64)y * axis_y->tap_count, axis_y->tap_count, row_stride);
+    }
+    imm_free(band);
+}
+
+// NOTE: the dst texture must have its pixels, width, height and pitch set
+void imm_resample(imm_texture_t *dst, imm_texture_t *src, imm_resample_filter_t filter)
+{
+    imm_resample_t resample;
+    imm_resample_begin(&resample, dst, src, filter);
+    for(u32 row = 0; row < dst->height; row += imm_resample_band_rows)
+    {
+        imm_resample_band(&resample, row, u32_min_2(imm_resample_band_rows, dst->height - row));
+    }
+    imm_resample_end(&resample);
+}
+
+struct imm_resample_band_job_t
+{
+    imm_resample_t *resample;
+    u32 first_row;
+    u32 row_count;
+    SDL_atomic_t *remaining;
+};
+
+void imm_resample_band_job(void *data)
+{
+    imm_resample_band_job_t *job = (imm_resample_band_job_t *)data;
+    imm_resample_band(job->resample, job->first_row, job->row_count);
+    SDL_AtomicAdd(job->remaining, -1);
+}
+
+// NOTE: the bands of one image run in the workers of the queue, the calling thread
+// helps until its bands are done. Must not be called from a job of the same queue
+void imm_resample_parallel(imm_job_queue_t *queue, imm_texture_t *dst, imm_texture_t *src, imm_resample_filter_t filter)
+{
+    imm_resample_t resample;
+    imm_resample_begin(&resample, dst, src, filter);
+
+    u32 band_count = (dst->height + imm_resample_band_rows - 1) / imm_resample_band_rows;
+    imm_resample_band_job_t *jobs = (imm_resample_band_job_t *)imm_alloc(band_count * sizeof(imm_resample_band_job_t), memory_tag_texture);
+    SDL_atomic_t remaining;
+    SDL_AtomicSet(&remaining, (int)band_count);
+    for(u32 i = 0; i < band_count; ++i)
+    {
+        imm_resample_band_job_t *job = jobs + i;
+        job->resample = &resample;
+        job->first_row = i * imm_resample_band_rows;
+        job->row_count = u32_min_2(imm_resample_band_rows, dst->height - job->first_row);
+        job->remaining = &remaining;
+        if(!imm_job_push(queue, imm_resample_band_job, job))
+        {
+            imm_resample_band_job(job);
+        }
+    }
+    while(SDL_AtomicGet(&remaining))
+    {
+        if(!imm_job_queue_help(queue))
+        {
+            SDL_Delay(0);
+        }
+    }
+
+    imm_free(jobs);
+    imm_resample_end(&resample);
+}
+
+// NOTE: halve the image with 2x2 boxes while it stays at least twice the target, the
+// filter then only sees a source at most 4 times bigger than the output. The last
+// odd row and column of every level are dropped
+imm_texture_t imm_resample_mip_reduce(imm_texture_t *src, u32 width, u32 height)
+{
+    imm_texture_t result = {};
+    imm_texture_t level = *src;
+    while((level.width / 2) >= (width * 2) && (level.height / 2) >= (height * 2))
+    {
+        imm_texture_t next = {};
+        next.width = level.width / 2;
+        next.height = level.height / 2;
+        next.pitch = next.width * 4;
+        next.pixels = imm_alloc((u64)next.pitch * next.height, memory_tag_texture);
+        imm_downsample_rgba_2x2((u8 *)next.pixels, next.pitch, (u8 *)level.pixels, level.pitch, next.width, next.height);
+        imm_free(result.pixels);
+        result = next;
+        level = next;
+    }
+    return result;
+}
+
+// NOTE: time every filter with every kernel level available in the cpu, single threaded
+// and in the queue, use it with a big image
+void imm_resample_bench(const char *path, imm_job_queue_t *queue, u32 width, u32 height)
+{
+    imm_texture_t src = imm_texture_load_bmp(path);
+    if(!src.pixels)
+    {
+        return;
+    }
+    imm_texture_t dst = {};
+    dst.width = width;
+    dst.height = height;
+    dst.pitch = width * 4;
+    dst.pixels = imm_alloc((u64)dst.pitch * dst.height, memory_tag_texture);
+
+    f64 frequency = (f64)SDL_GetPerformanceFrequency();
+    imm_resample_kernels_t *kernels = imm_resample_kernels;
+    for(u32 filter = 0; filter < resample_filter_count; ++filter)
+    {
+        for(u32 level = 0; level <= imm_resample_max_level; ++level)
+        {
+            imm_resample_kernels = imm_resample_kernel_table + level;
+            u64 start = SDL_GetPerformanceCounter();
+            imm_resample(&dst, &src, (imm_resample_filter_t)filter);
+            u64 middle = SDL_GetPerformanceCounter();
+            imm_resample_parallel(queue, &dst, &src, (imm_resample_filter_t)filter);
+            u64 end = SDL_GetPerformanceCounter();
+            printf("[resample-bench]: %s %ux%u -> %ux%u %-8s %-6s %.3f ms, %u threads %.3f ms\n", path, src.width, src.height,
+                   width, height, imm_resample_filter_names[filter], imm_resample_kernels->name,
+                   (f64)(middle - start) * 1000.0 / frequency, queue->thread_count + 1, (f64)(end - middle) * 1000.0 / frequency);
+        }
+    }
+    imm_resample_kernels = kernels;
+
+    imm_texture_free(&dst);
+    imm_texture_free(&src);
+}
+
+#endif // IMM_RESAMPLE_H
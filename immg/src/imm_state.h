@@ -0,0 +1,339 @@
+#ifndef IMM_STATE_H
+#define IMM_STATE_H
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <emmintrin.h>
+#include "imm_math.h"
+#include "imm_memory.h"
+
+//
+// widget ids
+//
+// NOTE: the id of a widget is the fnv-1a hash of its label seeded with the id of
+// the scope it lives in, so the same label in two different scopes never collide
+
+#define imm_id_stack_size 64
+#define imm_id_fnv_offset 2166136261u
+#define imm_id_fnv_prime 16777619u
+
+struct imm_id_stack_t
+{
+    u32 ids[imm_id_stack_size];
+    u32 count;
+};
+
+static imm_id_stack_t imm_id_stack;
+
+u32 imm_id_hash(char *label, u32 length, u32 seed)
+{
+    u32 hash = seed;
+    for(u32 i = 0; i < length; ++i)
+    {
+        hash ^= (u8)label[i];
+        hash *= imm_id_fnv_prime;
+    }
+    // NOTE: 0 is reserved for no widget
+    return hash ? hash : 1;
+}
+
+// NOTE: 64 bits fnv-1a
+u64 imm_hash_64(const char *data, u64 size)
+{
+    u64 hash = 14695981039346656037ull;
+    for(u64 i = 0; i < size; ++i)
+    {
+        hash ^= (u8)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+u32 imm_id(char *label, u32 length)
+{
+    u32 seed = imm_id_stack.count ? imm_id_stack.ids[imm_id_stack.count - 1] : imm_id_fnv_offset;
+    return imm_id_hash(label, length, seed);
+}
+
+u32 imm_id(char *label)
+{
+    return imm_id(label, (u32)strlen(label));
+}
+
+void imm_id_push(char *label)
+{
+    assert(imm_id_stack.count < imm_id_stack_size);
+    u32 id = imm_id(label);
+    imm_id_stack.ids[imm_id_stack.count++] = id;
+}
+
+void imm_id_pop()
+{
+    assert(imm_id_stack.count > 0);
+    imm_id_stack.count--;
+}
+
+//
+// persistent widget state
+//
+// NOTE: open addressing hash table in the style of swiss tables. The slots are
+// split in groups of 16, every slot has one control byte with the low 7 bits of
+// the hash (or empty/deleted), so one sse2 compare test the 16 slots of a group.
+// Every entry save the last frame it was used and the ones that were not used
+// in the frame are deleted in imm_state_end_frame. The table only grows or rehash
+// in imm_state_end_frame, so the pointers returned during a frame stay valid until
+// the end of the frame
+
+#define imm_state_group_size 16
+#define imm_state_ctrl_empty ((s8)-128)
+#define imm_state_ctrl_deleted ((s8)-2)
+
+struct imm_widget_state_t
+{
+    u32 id;
+    u32 last_frame;
+    v2 scroll;
+    f32 anim;
+    bool open;
+};
+
+struct imm_state_table_t
+{
+    s8 *ctrl;
+    imm_widget_state_t *slots;
+    u32 capacity;
+    u32 count;
+    u32 deleted;
+    u32 frame;
+    
+    // NOTE: stats
+    u32 max_probe;
+    u32 collected;
+    u32 overflowed;
+};
+
+// NOTE: returned when a frame asks for more new widgets than the free slots, the
+// state of those widgets is lost for the frame and the table grows at its end
+static imm_widget_state_t imm_state_overflow;
+
+inline u64 imm_state_hash(u32 id)
+{
+    u64 result = (u64)id * 0x9E3779B97F4A7C15ULL;
+    return result ^ (result >> 29);
+}
+
+inline s8 imm_state_h2(u64 hash)
+{
+    return (s8)(hash & 0x7F);
+}
+
+inline u32 imm_state_h1(u64 hash)
+{
+    return (u32)(hash >> 7);
+}
+
+void imm_state_table_alloc(imm_state_table_t *table, u32 capacity)
+{
+    // NOTE: capacity must be a power of two and at least one group
+    table->capacity = capacity;
+    table->count = 0;
+    table->deleted = 0;
+    table->ctrl = (s8 *)imm_alloc(capacity, memory_tag_state);
+    table->slots = (imm_widget_state_t *)imm_alloc(capacity * sizeof(imm_widget_state_t), memory_tag_state);
+    memset(table->ctrl, imm_state_ctrl_empty, capacity);
+}
+
+void imm_state_table_init(imm_state_table_t *table, u32 capacity)
+{
+    memset(table, 0, sizeof(*table));
+    imm_state_table_alloc(table, capacity < imm_state_group_size ? imm_state_group_size : capacity);
+}
+
+void imm_state_table_free(imm_state_table_t *table)
+{
+    imm_free(table->ctrl);
+    imm_free(table->slots);
+    table->ctrl = 0;
+    table->slots = 0;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+// NOTE: return the slot of the id or the first free slot of its probe sequence
+imm_widget_state_t *imm_state_find_slot(imm_state_table_t *table, u32 id, u64 hash, bool *found)
+{
+    u32 group_mask = (table->capacity / imm_state_group_size) - 1;
+    u32 group = imm_state_h1(hash) & group_mask;
+    __m128i h2 = _mm_set1_epi8(imm_state_h2(hash));
+    __m128i empty = _mm_set1_epi8(imm_state_ctrl_empty);
+    
+    s32 first_free = -1;
+    for(u32 step = 0; step <= group_mask; ++step)
+    {
+        u32 base = group * imm_state_group_size;
+        __m128i ctrl = _mm_loadu_si128((__m128i *)(table->ctrl + base));
+        
+        u32 match = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, h2));
+        while(match)
+        {
+            u32 index = base + u32_ctz(match);
+            if(table->slots[index].id == id)
+            {
+                table->max_probe = u32_max_2(table->max_probe, step + 1);
+                *found = true;
+                return table->slots + index;
+            }
+            match &= match - 1;
+        }
+        
+        // NOTE: empty and deleted are the only control bytes with the high bit set
+        u32 free_mask = (u32)_mm_movemask_epi8(ctrl);
+        if((first_free < 0) && free_mask)
+        {
+            first_free = (s32)(base + u32_ctz(free_mask));
+        }
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, empty)))
+        {
+            break;
+        }
+        group = (group + step + 1) & group_mask;
+    }
+    
+    *found = false;
+    return first_free >= 0 ? table->slots + first_free : 0;
+}
+
+void imm_state_table_rehash(imm_state_table_t *table, u32 capacity)
+{
+    imm_state_table_t old = *table;
+    imm_state_table_alloc(table, capacity);
+    for(u32 i = 0; i < old.capacity; ++i)
+    {
+        if(old.ctrl[i] >= 0)
+        {
+            imm_widget_state_t *entry = old.slots + i;
+            u64 hash = imm_state_hash(entry->id);
+            bool found;
+            imm_widget_state_t *slot = imm_state_find_slot(table, entry->id, hash, &found);
+            table->ctrl[slot - table->slots] = imm_state_h2(hash);
+            *slot = *entry;
+            table->count++;
+        }
+    }
+    imm_free(old.ctrl);
+    imm_free(old.slots);
+}
+
+// NOTE: get the state of a widget, the first time a zero state is created. The
+// pointer is valid until imm_state_end_frame
+imm_widget_state_t *imm_state_get(imm_state_table_t *table, u32 id)
+{
+    u64 hash = imm_state_hash(id);
+    bool found;
+    imm_widget_state_t *slot = imm_state_find_slot(table, id, hash, &found);
+    if(!found)
+    {
+        if(!slot)
+        {
+            table->overflowed++;
+            memset(&imm_state_overflow, 0, sizeof(imm_state_overflow));
+            imm_state_overflow.id = id;
+            return &imm_state_overflow;
+        }
+        u32 index = (u32)(slot - table->slots);
+        if(table->ctrl[index] == imm_state_ctrl_deleted)
+        {
+            table->deleted--;
+        }
+        table->ctrl[index] = imm_state_h2(hash);
+        memset(slot, 0, sizeof(*slot));
+        slot->id = id;
+        table->count++;
+    }
+    slot->last_frame = table->frame;
+    return slot;
+}
+
+// NOTE: delete every entry that was not used in this frame
+void imm_state_end_frame(imm_state_table_t *table)
+{
+    table->collected = 0;
+    for(u32 base = 0; base < table->capacity; base += imm_state_group_size)
+    {
+        __m128i ctrl = _mm_loadu_si128((__m128i *)(table->ctrl + base));
+        u32 full = ~(u32)_mm_movemask_epi8(ctrl) & 0xFFFF;
+        while(full)
+        {
+            u32 index = base + u32_ctz(full);
+            if(table->slots[index].last_frame != table->frame)
+            {
+                table->ctrl[index] = imm_state_ctrl_deleted;
+                table->count--;
+                table->deleted++;
+                table->collected++;
+            }
+            full &= full - 1;
+        }
+    }
+
+    // NOTE: leave at least half of the table free for the new widgets of the next frame,
+    // the widgets that did not fit in this frame count as new ones. With mostly
+    // tombstones the table is rehashed with the same size to clean them
+    u32 capacity = table->capacity;
+    while(((table->count + table->overflowed) * 2) > capacity)
+    {
+        capacity *= 2;
+    }
+    if(capacity != table->capacity || ((table->count + table->deleted) * 2) > table->capacity)
+    {
+        imm_state_table_rehash(table, capacity);
+    }
+    table->overflowed = 0;
+    table->frame++;
+}
+
+void imm_state_stats_print(imm_state_table_t *table)
+{
+    printf("[state]: %u entries, %u tombstones, capacity %u, max probe %u groups, %u collected last frame\n",
+           table->count, table->deleted, table->capacity, table->max_probe, table->collected);
+}
+
+// NOTE: frames of widget_count widgets where a tenth of the widgets are replaced by
+// new ones every frame, like a scrolling list. Times the lookups of the frames and
+// the end of the frames
+void imm_state_bench(u32 widget_count, u32 frame_count)
+{
+    imm_state_table_t table;
+    imm_state_table_init(&table, 1024);
+    f64 frequency = (f64)SDL_GetPerformanceFrequency();
+    u64 lookup_ticks = 0;
+    u64 end_ticks = 0;
+    u64 anim = 0;
+    for(u32 frame = 0; frame < frame_count; ++frame)
+    {
+        u32 first = frame * (widget_count / 10);
+        u64 start = SDL_GetPerformanceCounter();
+        for(u32 i = 0; i < widget_count; ++i)
+        {
+            u32 key = first + i;
+            imm_widget_state_t *state = imm_state_get(&table, imm_id_hash((char *)&key, sizeof(key), imm_id_fnv_offset));
+            state->anim += 1.0f;
+            anim += (u64)state->anim;
+        }
+        u64 middle = SDL_GetPerformanceCounter();
+        imm_state_end_frame(&table);
+        lookup_ticks += middle - start;
+        end_ticks += SDL_GetPerformanceCounter() - middle;
+    }
+    u64 lookups = (u64)widget_count * frame_count;
+    printf("[state-bench]: %u widgets %u frames, %.1f ns per lookup, %.3f ms per end of frame (%llu)\n", widget_count, frame_count,
+           (f64)lookup_ticks * 1000000000.0 / frequency / (f64)lookups, (f64)end_ticks * 1000.0 / frequency / (f64)frame_count,
+           (unsigned long long)anim);
+    imm_state_stats_print(&table);
+    imm_state_table_free(&table);
+}
+
+#endif // IMM_STATE_H
@@ -0,0 +1,846 @@
+#ifndef IMM_TEXT_EDIT_H
+#define IMM_TEXT_EDIT_H
+
+#include <SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include "imm_math.h"
+#include "imm_memory.h"
+
+// NOTE: editable text for big inputs. The text lives in a gap buffer so typing in one
+// place only moves the gap once, the line starts are an array with a pending delta
+// for the lines after the last edit so typing in a line of a big file does not touch
+// the rest of the lines, and the x of every byte of a line is cached in a small
+// set of layout slots that are only thrown away when the line is edited
+
+inline bool imm_utf8_is_continuation(char c)
+{
+    return ((u8)c & 0xC0) == 0x80;
+}
+
+// NOTE: decode one utf8 codepoint, invalid sequences return '?' and consume one byte.
+// A sequence is invalid when it is cut, when a trailing byte is not a continuation,
+// when it is longer than needed or when it encodes a surrogate or a value past 0x10FFFF
+u32 imm_utf8_decode(char *text, u32 length, u32 *consumed)
+{
+    u8 *c = (u8 *)text;
+    *consumed = 1;
+    if(c[0] < 0x80)
+    {
+        return c[0];
+    }
+
+    u32 count = 0;
+    u32 codepoint = 0;
+    u32 min_codepoint = 0;
+    if((c[0] & 0xE0) == 0xC0)
+    {
+        count = 2;
+        codepoint = c[0] & 0x1F;
+        min_codepoint = 0x80;
+    }
+    else if((c[0] & 0xF0) == 0xE0)
+    {
+        count = 3;
+        codepoint = c[0] & 0x0F;
+        min_codepoint = 0x800;
+    }
+    else if((c[0] & 0xF8) == 0xF0)
+    {
+        count = 4;
+        codepoint = c[0] & 0x07;
+        min_codepoint = 0x10000;
+    }
+    if(count == 0 || length < count)
+    {
+        return '?';
+    }
+    for(u32 i = 1; i < count; ++i)
+    {
+        if(!imm_utf8_is_continuation((char)c[i]))
+        {
+            return '?';
+        }
+        codepoint = (codepoint << 6) | (c[i] & 0x3F);
+    }
+    if(codepoint < min_codepoint || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+    {
+        return '?';
+    }
+    *consumed = count;
+    return codepoint;
+}
+
+//
+// gap buffer
+//
+
+struct imm_gap_buffer_t
+{
+    char *data;
+    u32 capacity;
+    u32 gap_start;
+    u32 gap_end;
+};
+
+void imm_gap_buffer_init(imm_gap_buffer_t *buffer, u32 capacity)
+{
+    buffer->data = (char *)imm_alloc(capacity, memory_tag_text);
+    buffer->capacity = capacity;
+    buffer->gap_start = 0;
+    buffer->gap_end = capacity;
+}
+
+void imm_gap_buffer_free(imm_gap_buffer_t *buffer)
+{
+    imm_free(buffer->data);
+    buffer->data = 0;
+    buffer->capacity = 0;
+    buffer->gap_start = 0;
+    buffer->gap_end = 0;
+}
+
+inline u32 imm_gap_buffer_length(imm_gap_buffer_t *buffer)
+{
+    return buffer->capacity - (buffer->gap_end - buffer->gap_start);
+}
+
+inline char imm_gap_buffer_at(imm_gap_buffer_t *buffer, u32 position)
+{
+    return position < buffer->gap_start ? buffer->data[position] : buffer->data[position + (buffer->gap_end - buffer->gap_start)];
+}
+
+void imm_gap_buffer_move_gap(imm_gap_buffer_t *buffer, u32 position)
+{
+    if(position < buffer->gap_start)
+    {
+        u32 count = buffer->gap_start - position;
+        memmove(buffer->data + buffer->gap_end - count, buffer->data + position, count);
+        buffer->gap_start -= count;
+        buffer->gap_end -= count;
+    }
+    else if(position > buffer->gap_start)
+    {
+        u32 count = position - buffer->gap_start;
+        memmove(buffer->data + buffer->gap_start, buffer->data + buffer->gap_end, count);
+        buffer->gap_start += count;
+        buffer->gap_end += count;
+    }
+}
+
+// NOTE: the buffer grows to double size so a long paste is not a chain of copies
+void imm_gap_buffer_reserve(imm_gap_buffer_t *buffer, u32 size)
+{
+    u32 gap = buffer->gap_end - buffer->gap_start;
+    if(gap >= size)
+    {
+        return;
+    }
+    u32 length = imm_gap_buffer_length(buffer);
+    u32 capacity = u32_max_2(buffer->capacity * 2, length + size + KB(4));
+    char *data = (char *)imm_alloc(capacity, memory_tag_text);
+    u32 tail = buffer->capacity - buffer->gap_end;
+    memcpy(data, buffer->data, buffer->gap_start);
+    memcpy(data + capacity - tail, buffer->data + buffer->gap_end, tail);
+    imm_free(buffer->data);
+    buffer->data = data;
+    buffer->gap_end = capacity - tail;
+    buffer->capacity = capacity;
+}
+
+void imm_gap_buffer_insert(imm_gap_buffer_t *buffer, u32 position, const char *text, u32 length)
+{
+    imm_gap_buffer_reserve(buffer, length);
+    imm_gap_buffer_move_gap(buffer, position);
+    memcpy(buffer->data + buffer->gap_start, text, length);
+    buffer->gap_start += length;
+}
+
+void imm_gap_buffer_remove(imm_gap_buffer_t *buffer, u32 position, u32 length)
+{
+    imm_gap_buffer_move_gap(buffer, position);
+    buffer->gap_end += length;
+}
+
+// NOTE: copy a range of the text to contiguous memory, return the bytes copied
+u32 imm_gap_buffer_copy(imm_gap_buffer_t *buffer, u32 position, u32 length, char *dst)
+{
+    length = u32_min_2(length, imm_gap_buffer_length(buffer) - position);
+    u32 before = position < buffer->gap_start ? u32_min_2(buffer->gap_start - position, length) : 0;
+    memcpy(dst, buffer->data + position, before);
+    u32 gap = buffer->gap_end - buffer->gap_start;
+    memcpy(dst + before, buffer->data + position + before + gap, length - before);
+    return length;
+}
+
+//
+// text edit
+//
+
+// NOTE: return false when the advance is only an estimate (glyph not ready yet),
+// the layout is used for this frame but not kept
+typedef bool imm_text_measure_t(void *user, u32 codepoint, f32 *advance);
+
+#define imm_text_no_slot 0xFFFFFFFF
+#define imm_text_layout_slots 256
+
+struct imm_text_line_t
+{
+    // NOTE: lines from delta_line on must add the pending delta
+    u32 start;
+    u32 slot;
+    u32 generation;
+};
+
+// NOTE: x of the start of every byte of the line, count is the line length + 1
+struct imm_text_layout_slot_t
+{
+    f32 *x;
+    u32 count;
+    u32 capacity;
+    u32 generation;
+    u32 last_used;
+    bool used;
+};
+
+struct imm_text_edit_stats_t
+{
+    u64 edits;
+    u64 edit_ticks;
+    u64 layouts;
+    u64 layout_hits;
+
+    // NOTE: from the first input event not yet presented to the present
+    u64 input_ticks;
+    u64 latency_count;
+    u64 latency_total;
+    u64 latency_max;
+};
+
+struct imm_text_edit_t
+{
+    imm_gap_buffer_t text;
+
+    imm_text_line_t *lines;
+    u32 line_count;
+    u32 line_capacity;
+    u32 delta_line;
+    s32 delta;
+
+    imm_text_layout_slot_t slots[imm_text_layout_slots];
+    u32 frame;
+    imm_text_measure_t *measure;
+    void *measure_user;
+    char *scratch;
+    u32 scratch_size;
+
+    u32 caret;
+    u32 anchor;
+    f32 preferred_x;
+    u32 scroll_line;
+
+    imm_text_edit_stats_t stats;
+};
+
+inline u32 imm_text_edit_line_start(imm_text_edit_t *edit, u32 line)
+{
+    return line >= edit->delta_line ? (u32)((s32)edit->lines[line].start + edit->delta) : edit->lines[line].start;
+}
+
+// NOTE: end of the line without the '\n'
+inline u32 imm_text_edit_line_end(imm_text_edit_t *edit, u32 line)
+{
+    return (line + 1) < edit->line_count ? imm_text_edit_line_start(edit, line + 1) - 1 : imm_gap_buffer_length(&edit->text);
+}
+
+u32 imm_text_edit_line_of(imm_text_edit_t *edit, u32 position)
+{
+    u32 low = 0;
+    u32 high = edit->line_count - 1;
+    while(low < high)
+    {
+        u32 middle = (low + high + 1) / 2;
+        if(imm_text_edit_line_start(edit, middle) <= position)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+// NOTE: move the start of the pending delta, only the lines between the old and
+// the new edit are touched so typing in the same line is constant time
+void imm_text_edit_move_delta(imm_text_edit_t *edit, u32 line)
+{
+    if(edit->delta)
+    {
+        while(edit->delta_line < line)
+        {
+            edit->lines[edit->delta_line++].start += edit->delta;
+        }
+        while(edit->delta_line > line)
+        {
+            edit->lines[--edit->delta_line].start -= edit->delta;
+        }
+    }
+    edit->delta_line = line;
+    if(edit->delta_line >= edit->line_count)
+    {
+        edit->delta = 0;
+    }
+}
+
+void imm_text_edit_reserve_lines(imm_text_edit_t *edit, u32 count)
+{
+    if((edit->line_count + count) <= edit->line_capacity)
+    {
+        return;
+    }
+    u32 capacity = u32_max_2(edit->line_capacity * 2, edit->line_count + count + 1024);
+    imm_text_line_t *lines = (imm_text_line_t *)imm_alloc(capacity * sizeof(imm_text_line_t), memory_tag_text);
+    if(edit->lines)
+    {
+        memcpy(lines, edit->lines, edit->line_count * sizeof(imm_text_line_t));
+        imm_free(edit->lines);
+    }
+    edit->lines = lines;
+    edit->line_capacity = capacity;
+}
+
+void imm_text_edit_invalidate_line(imm_text_edit_t *edit, u32 line)
+{
+    imm_text_line_t *entry = edit->lines + line;
+    if(entry->slot != imm_text_no_slot)
+    {
+        imm_text_layout_slot_t *slot = edit->slots + entry->slot;
+        if(slot->generation == entry->generation)
+        {
+            slot->used = false;
+            slot->generation++;
+        }
+        entry->slot = imm_text_no_slot;
+    }
+}
+
+void imm_text_edit_init(imm_text_edit_t *edit, imm_text_measure_t *measure, void *measure_user)
+{
+    memset(edit, 0, sizeof(*edit));
+    imm_gap_buffer_init(&edit->text, KB(64));
+    imm_text_edit_reserve_lines(edit, 1);
+    edit->lines[0].start = 0;
+    edit->lines[0].slot = imm_text_no_slot;
+    edit->line_count = 1;
+    edit->measure = measure;
+    edit->measure_user = measure_user;
+}
+
+void imm_text_edit_free(imm_text_edit_t *edit)
+{
+    imm_gap_buffer_free(&edit->text);
+    imm_free(edit->lines);
+    imm_free(edit->scratch);
+    for(u32 i = 0; i < imm_text_layout_slots; ++i)
+    {
+        imm_free(edit->slots[i].x);
+    }
+    memset(edit, 0, sizeof(*edit));
+}
+
+void imm_text_edit_insert(imm_text_edit_t *edit, u32 position, const char *text, u32 length)
+{
+    if(!length)
+    {
+        return;
+    }
+    u64 start_ticks = SDL_GetPerformanceCounter();
+
+    u32 line = imm_text_edit_line_of(edit, position);
+    imm_text_edit_move_delta(edit, line + 1);
+    imm_gap_buffer_insert(&edit->text, position, text, length);
+
+    u32 new_lines = 0;
+    for(u32 i = 0; i < length; ++i)
+    {
+        new_lines += text[i] == '\n';
+    }
+    if(new_lines)
+    {
+        // NOTE: the new lines are exact, the lines after them keep the pending delta
+        imm_text_edit_reserve_lines(edit, new_lines);
+        memmove(edit->lines + line + 1 + new_lines, edit->lines + line + 1, (edit->line_count - line - 1) * sizeof(imm_text_line_t));
+        u32 index = line + 1;
+        for(u32 i = 0; i < length; ++i)
+        {
+            if(text[i] == '\n')
+            {
+                imm_text_line_t *entry = edit->lines + index++;
+                entry->start = position + i + 1;
+                entry->slot = imm_text_no_slot;
+                entry->generation = 0;
+            }
+        }
+        edit->line_count += new_lines;
+        edit->delta_line += new_lines;
+    }
+    edit->delta += (s32)length;
+    if(edit->delta_line >= edit->line_count)
+    {
+        edit->delta = 0;
+    }
+    imm_text_edit_invalidate_line(edit, line);
+
+    edit->stats.edits++;
+    edit->stats.edit_ticks += SDL_GetPerformanceCounter() - start_ticks;
+}
+
+void imm_text_edit_remove(imm_text_edit_t *edit, u32 position, u32 length)
+{
+    length = u32_min_2(length, imm_gap_buffer_length(&edit->text) - position);
+    if(!length)
+    {
+        return;
+    }
+    u64 start_ticks = SDL_GetPerformanceCounter();
+
+    u32 first = imm_text_edit_line_of(edit, position);
+    u32 last = imm_text_edit_line_of(edit, position + length);
+    imm_text_edit_move_delta(edit, last + 1);
+    imm_gap_buffer_remove(&edit->text, position, length);
+
+    u32 removed = last - first;
+    if(removed)
+    {
+        for(u32 line = first + 1; line <= last; ++line)
+        {
+            imm_text_edit_invalidate_line(edit, line);
+        }
+        memmove(edit->lines + first + 1, edit->lines + last + 1, (edit->line_count - last - 1) * sizeof(imm_text_line_t));
+        edit->line_count -= removed;
+        edit->delta_line -= removed;
+    }
+    edit->delta -= (s32)length;
+    if(edit->delta_line >= edit->line_count)
+    {
+        edit->delta = 0;
+    }
+    imm_text_edit_invalidate_line(edit, first);
+
+    edit->stats.edits++;
+    edit->stats.edit_ticks += SDL_GetPerformanceCounter() - start_ticks;
+}
+
+// NOTE: replace all the text, the line index is build in one pass
+void imm_text_edit_set_text(imm_text_edit_t *edit, const char *text, u32 length)
+{
+    for(u32 line = 0; line < edit->line_count; ++line)
+    {
+        imm_text_edit_invalidate_line(edit, line);
+    }
+    edit->text.gap_start = 0;
+    edit->text.gap_end = edit->text.capacity;
+    imm_gap_buffer_insert(&edit->text, 0, text, length);
+
+    edit->line_count = 1;
+    edit->delta_line = 0;
+    edit->delta = 0;
+    edit->lines[0].start = 0;
+    edit->lines[0].slot = imm_text_no_slot;
+    for(u32 i = 0; i < length; ++i)
+    {
+        if(text[i] == '\n')
+        {
+            imm_text_edit_reserve_lines(edit, 1);
+            imm_text_line_t *entry = edit->lines + edit->line_count++;
+            entry->start = i + 1;
+            entry->slot = imm_text_no_slot;
+            entry->generation = 0;
+        }
+    }
+    edit->caret = 0;
+    edit->anchor = 0;
+    edit->scroll_line = 0;
+}
+
+// NOTE: the cached x of every byte of the line, the least recently used slot is
+// reused when all are taken
+imm_text_layout_slot_t *imm_text_edit_layout(imm_text_edit_t *edit, u32 line)
+{
+    imm_text_line_t *entry = edit->lines + line;
+    if(entry->slot != imm_text_no_slot && edit->slots[entry->slot].generation == entry->generation && edit->slots[entry->slot].used)
+    {
+        imm_text_layout_slot_t *slot = edit->slots + entry->slot;
+        slot->last_used = edit->frame;
+        edit->stats.layout_hits++;
+        return slot;
+    }
+
+    u32 best = 0;
+    for(u32 i = 0; i < imm_text_layout_slots; ++i)
+    {
+        if(!edit->slots[i].used)
+        {
+            best = i;
+            break;
+        }
+        if(edit->slots[i].last_used < edit->slots[best].last_used)
+        {
+            best = i;
+        }
+    }
+    imm_text_layout_slot_t *slot = edit->slots + best;
+    slot->generation++;
+
+    u32 start = imm_text_edit_line_start(edit, line);
+    u32 length = imm_text_edit_line_end(edit, line) - start;
+    if(length > edit->scratch_size)
+    {
+        imm_free(edit->scratch);
+        edit->scratch_size = u32_max_2(length, edit->scratch_size * 2);
+        edit->scratch = (char *)imm_alloc(edit->scratch_size, memory_tag_text);
+    }
+    imm_gap_buffer_copy(&edit->text, start, length, edit->scratch);
+
+    if((length + 1) > slot->capacity)
+    {
+        imm_free(slot->x);
+        slot->capacity = u32_max_2(length + 1, 128);
+        slot->x = (f32 *)imm_alloc(slot->capacity * sizeof(f32), memory_tag_text);
+    }
+
+    bool exact = true;
+    f32 x = 0;
+    u32 consumed = 0;
+    for(u32 offset = 0; offset < length; offset += consumed)
+    {
+        u32 codepoint = imm_utf8_decode(edit->scratch + offset, length - offset, &consumed);
+        f32 advance = 0;
+        exact &= edit->measure(edit->measure_user, codepoint, &advance);
+        for(u32 i = 0; i < consumed; ++i)
+        {
+            slot->x[offset + i] = x;
+        }
+        x += advance;
+    }
+    slot->x[length] = x;
+    slot->count = length + 1;
+    slot->last_used = edit->frame;
+
+    // NOTE: an estimated layout stays in the slot only until the next request
+    slot->used = exact;
+    entry->slot = exact ? best : imm_text_no_slot;
+    entry->generation = slot->generation;
+    edit->stats.layouts++;
+    return slot;
+}
+
+// NOTE: byte position of the line nearest to x, always the start of a codepoint
+u32 imm_text_edit_position_at_x(imm_text_edit_t *edit, u32 line, f32 x)
+{
+    imm_text_layout_slot_t *slot = imm_text_edit_layout(edit, line);
+    u32 low = 0;
+    u32 high = slot->count - 1;
+    while(low < high)
+    {
+        u32 middle = (low + high + 1) / 2;
+        if(slot->x[middle] <= x)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+    u32 start = imm_text_edit_line_start(edit, line);
+    // NOTE: the last position of the last line is the end of the text, there is no byte to read
+    while(low > 0 && low < (slot->count - 1) && imm_utf8_is_continuation(imm_gap_buffer_at(&edit->text, start + low)))
+    {
+        low--;
+    }
+    // NOTE: the next codepoint if x is past the middle of this one
+    u32 next = low + 1;
+    while(next < (slot->count - 1) && imm_utf8_is_continuation(imm_gap_buffer_at(&edit->text, start + next)))
+    {
+        next++;
+    }
+    if(next < slot->count && (x - slot->x[low]) > (slot->x[next] - x))
+    {
+        low = next;
+    }
+    return start + low;
+}
+
+f32 imm_text_edit_x_of(imm_text_edit_t *edit, u32 position, u32 *line_out)
+{
+    u32 line = imm_text_edit_line_of(edit, position);
+    imm_text_layout_slot_t *slot = imm_text_edit_layout(edit, line);
+    if(line_out)
+    {
+        *line_out = line;
+    }
+    return slot->x[position - imm_text_edit_line_start(edit, line)];
+}
+
+inline u32 imm_text_edit_selection_min(imm_text_edit_t *edit)
+{
+    return edit->caret < edit->anchor ? edit->caret : edit->anchor;
+}
+
+inline u32 imm_text_edit_selection_max(imm_text_edit_t *edit)
+{
+    return edit->caret > edit->anchor ? edit->caret : edit->anchor;
+}
+
+void imm_text_edit_delete_selection(imm_text_edit_t *edit)
+{
+    u32 min = imm_text_edit_selection_min(edit);
+    imm_text_edit_remove(edit, min, imm_text_edit_selection_max(edit) - min);
+    edit->caret = min;
+    edit->anchor = min;
+}
+
+// NOTE: typed text replace the selection
+void imm_text_edit_type(imm_text_edit_t *edit, const char *text, u32 length)
+{
+    imm_text_edit_delete_selection(edit);
+    imm_text_edit_insert(edit, edit->caret, text, length);
+    edit->caret += length;
+    edit->anchor = edit->caret;
+    edit->preferred_x = imm_text_edit_x_of(edit, edit->caret, 0);
+}
+
+enum imm_text_edit_key_t
+{
+    text_edit_key_left,
+    text_edit_key_right,
+    text_edit_key_up,
+    text_edit_key_down,
+    text_edit_key_home,
+    text_edit_key_end,
+    text_edit_key_backspace,
+    text_edit_key_delete,
+    text_edit_key_enter,
+};
+
+u32 imm_text_edit_next(imm_text_edit_t *edit, u32 position)
+{
+    u32 length = imm_gap_buffer_length(&edit->text);
+    if(position < length)
+    {
+        position++;
+        while(position < length && imm_utf8_is_continuation(imm_gap_buffer_at(&edit->text, position)))
+        {
+            position++;
+        }
+    }
+    return position;
+}
+
+u32 imm_text_edit_previous(imm_text_edit_t *edit, u32 position)
+{
+    if(position > 0)
+    {
+        position--;
+        while(position > 0 && imm_utf8_is_continuation(imm_gap_buffer_at(&edit->text, position)))
+        {
+            position--;
+        }
+    }
+    return position;
+}
+
+void imm_text_edit_key(imm_text_edit_t *edit, imm_text_edit_key_t key, bool shift)
+{
+    bool selection = edit->caret != edit->anchor;
+    u32 line = imm_text_edit_line_of(edit, edit->caret);
+    bool vertical = false;
+    switch(key)
+    {
+    case text_edit_key_left:
+    {
+        edit->caret = (selection && !shift) ? imm_text_edit_selection_min(edit) : imm_text_edit_previous(edit, edit->caret);
+    }break;
+    case text_edit_key_right:
+    {
+        edit->caret = (selection && !shift) ? imm_text_edit_selection_max(edit) : imm_text_edit_next(edit, edit->caret);
+    }break;
+    case text_edit_key_up:
+    {
+        vertical = true;
+        edit->caret = line > 0 ? imm_text_edit_position_at_x(edit, line - 1, edit->preferred_x) : 0;
+    }break;
+    case text_edit_key_down:
+    {
+        vertical = true;
+        edit->caret = (line + 1) < edit->line_count ? imm_text_edit_position_at_x(edit, line + 1, edit->preferred_x) : imm_gap_buffer_length(&edit->text);
+    }break;
+    case text_edit_key_home:
+    {
+        edit->caret = imm_text_edit_line_start(edit, line);
+    }break;
+    case text_edit_key_end:
+    {
+        edit->caret = imm_text_edit_line_end(edit, line);
+    }break;
+    case text_edit_key_backspace:
+    case text_edit_key_delete:
+    {
+        if(!selection)
+        {
+            edit->anchor = key == text_edit_key_backspace ? imm_text_edit_previous(edit, edit->caret) : imm_text_edit_next(edit, edit->caret);
+        }
+        imm_text_edit_delete_selection(edit);
+        shift = false;
+    }break;
+    case text_edit_key_enter:
+    {
+        imm_text_edit_type(edit, "\n", 1);
+        return;
+    }break;
+    }
+    if(!shift)
+    {
+        edit->anchor = edit->caret;
+    }
+    if(!vertical)
+    {
+        edit->preferred_x = imm_text_edit_x_of(edit, edit->caret, 0);
+    }
+}
+
+// NOTE: keep the caret line inside the visible lines
+void imm_text_edit_scroll_to_caret(imm_text_edit_t *edit, u32 visible_lines)
+{
+    u32 line = imm_text_edit_line_of(edit, edit->caret);
+    if(line < edit->scroll_line)
+    {
+        edit->scroll_line = line;
+    }
+    else if(visible_lines && line >= (edit->scroll_line + visible_lines))
+    {
+        edit->scroll_line = line - visible_lines + 1;
+    }
+}
+
+// NOTE: the latency is measured from the first input of a frame to its present
+void imm_text_edit_input_event(imm_text_edit_t *edit)
+{
+    if(!edit->stats.input_ticks)
+    {
+        edit->stats.input_ticks = SDL_GetPerformanceCounter();
+    }
+}
+
+void imm_text_edit_presented(imm_text_edit_t *edit)
+{
+    edit->frame++;
+    if(edit->stats.input_ticks)
+    {
+        u64 latency = SDL_GetPerformanceCounter() - edit->stats.input_ticks;
+        edit->stats.latency_count++;
+        edit->stats.latency_total += latency;
+        if(latency > edit->stats.latency_max)
+        {
+            edit->stats.latency_max = latency;
+        }
+        edit->stats.input_ticks = 0;
+    }
+}
+
+void imm_text_edit_stats_print(imm_text_edit_t *edit)
+{
+    imm_text_edit_stats_t *stats = &edit->stats;
+    f64 frequency = (f64)SDL_GetPerformanceFrequency();
+    printf("[text-edit]: %u bytes %u lines, %llu edits %.3f us avg, %llu layouts %llu cached\n",
+           imm_gap_buffer_length(&edit->text), edit->line_count, (unsigned long long)stats->edits,
+           stats->edits ? ((f64)stats->edit_ticks * 1000000.0 / frequency) / (f64)stats->edits : 0.0,
+           (unsigned long long)stats->layouts, (unsigned long long)stats->layout_hits);
+    printf("[text-edit]: input to present %.3f ms avg %.3f ms max over %llu frames\n",
+           stats->latency_count ? ((f64)stats->latency_total * 1000.0 / frequency) / (f64)stats->latency_count : 0.0,
+           (f64)stats->latency_max * 1000.0 / frequency, (unsigned long long)stats->latency_count);
+    stats->latency_count = 0;
+    stats->latency_total = 0;
+    stats->latency_max = 0;
+}
+
+bool imm_text_edit_bench_measure(void *, u32 codepoint, f32 *advance)
+{
+    *advance = codepoint == '\t' ? 32.0f : 8.0f;
+    return true;
+}
+
+// NOTE: type in the middle of a big buffer like a user would, every edit is followed
+// by the layout of the visible lines as the frame would do
+void imm_text_edit_bench(u32 line_count, u32 edit_count, u32 visible_lines)
+{
+    imm_text_edit_t *edit = (imm_text_edit_t *)imm_alloc(sizeof(imm_text_edit_t), memory_tag_text);
+    imm_text_edit_init(edit, imm_text_edit_bench_measure, 0);
+
+    u32 text_size = line_count * 48;
+    char *text = (char *)imm_alloc(text_size, memory_tag_text);
+    u32 length = 0;
+    for(u32 line = 0; line < line_count; ++line)
+    {
+        length += (u32)snprintf(text + length, text_size - length, "%06u: the quick brown fox jumps over it\n", line);
+    }
+
+    f64 frequency = (f64)SDL_GetPerformanceFrequency();
+    u64 start = SDL_GetPerformanceCounter();
+    imm_text_edit_set_text(edit, text, length);
+    f64 load_ms = (f64)(SDL_GetPerformanceCounter() - start) * 1000.0 / frequency;
+    imm_free(text);
+
+    edit->caret = imm_text_edit_line_start(edit, line_count / 2);
+    edit->anchor = edit->caret;
+    u32 seed = 1;
+    u64 max_ticks = 0;
+    start = SDL_GetPerformanceCounter();
+    for(u32 i = 0; i < edit_count; ++i)
+    {
+        u64 edit_start = SDL_GetPerformanceCounter();
+        seed = seed * 1664525 + 1013904223;
+        u32 action = (seed >> 16) % 16;
+        if(action < 10)
+        {
+            imm_text_edit_type(edit, "x", 1);
+        }
+        else if(action < 12)
+        {
+            imm_text_edit_key(edit, text_edit_key_backspace, false);
+        }
+        else if(action < 13)
+        {
+            imm_text_edit_key(edit, text_edit_key_enter, false);
+        }
+        else
+        {
+            imm_text_edit_key(edit, action == 13 ? text_edit_key_up : text_edit_key_down, false);
+        }
+        imm_text_edit_scroll_to_caret(edit, visible_lines);
+        for(u32 line = edit->scroll_line; line < u32_min_2(edit->scroll_line + visible_lines, edit->line_count); ++line)
+        {
+            imm_text_edit_layout(edit, line);
+        }
+        edit->frame++;
+        u64 ticks = SDL_GetPerformanceCounter() - edit_start;
+        if(ticks > max_ticks)
+        {
+            max_ticks = ticks;
+        }
+    }
+    f64 total_ms = (f64)(SDL_GetPerformanceCounter() - start) * 1000.0 / frequency;
+
+    printf("[text-edit-bench]: %u lines %u bytes loaded in %.3f ms\n", edit->line_count, imm_gap_buffer_length(&edit->text), load_ms);
+    printf("[text-edit-bench]: %u edits with %u visible lines, %.3f us avg %.3f us max per edit\n",
+           edit_count, visible_lines, total_ms * 1000.0 / (f64)edit_count, (f64)max_ticks * 1000000.0 / frequency);
+    imm_text_edit_stats_print(edit);
+
+    imm_text_edit_free(edit);
+    imm_free(edit);
+}
+
+#endif // IMM_TEXT_EDIT_H
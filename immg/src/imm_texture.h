@@ -0,0 +1,463 @@
+#ifndef IMM_TEXTURE_H
+#define IMM_TEXTURE_H
+
+#include <SDL.h>
+#include <glad/glad.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include "imm_math.h"
+#include "imm_memory.h"
+#include "imm_backend.h"
+
+// NOTE: all textures are rgba8 with the first row at the top of the image
+struct imm_texture_t
+{
+    void *pixels;
+    u32 width, height;
+    s32 pitch;
+    unsigned int texture_id;
+};
+
+// NOTE: 64 bits file offsets, big images do not fit in a long on windows
+inline int imm_file_seek(FILE *file, u64 offset)
+{
+#ifdef _MSC_VER
+    return _fseeki64(file, (__int64)offset, SEEK_SET);
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+}
+
+inline u64 imm_file_size(FILE *file)
+{
+#ifdef _MSC_VER
+    _fseeki64(file, 0, SEEK_END);
+    u64 result = (u64)_ftelli64(file);
+#else
+    fseeko(file, 0, SEEK_END);
+    u64 result = (u64)ftello(file);
+#endif
+    imm_file_seek(file, 0);
+    return result;
+}
+
+// NOTE: modification time in seconds and size of a file, false if it does not exist
+bool imm_file_stat(const char *path, u64 *mtime, u64 *size)
+{
+#ifdef _MSC_VER
+    struct _stat64 info;
+    if(_stat64(path, &info) != 0)
+    {
+        return false;
+    }
+#else
+    struct stat info;
+    if(stat(path, &info) != 0)
+    {
+        return false;
+    }
+#endif
+    *mtime = (u64)info.st_mtime;
+    *size = (u64)info.st_size;
+    return true;
+}
+
+// NOTE: the whole file with a 0 after the last byte, 0 with a size of 0 when the
+// file can not be read
+void *imm_read_entire_file(const char *path, u64 *file_size)
+{
+    *file_size = 0;
+    FILE *file = fopen(path, "rb");
+    if(!file)
+    {
+        printf("[file-error]: could not open %s\n", path);
+        return 0;
+    }
+    u64 size = imm_file_size(file);
+    void *buffer = imm_alloc(size + 1, memory_tag_file_io);
+    if(buffer && size && fread(buffer, (size_t)size, 1, file) != 1)
+    {
+        printf("[file-error]: fail to read %s\n", path);
+        imm_free(buffer);
+        buffer = 0;
+    }
+    if(buffer)
+    {
+        ((char *)buffer)[size] = 0;
+        *file_size = size;
+    }
+    fclose(file);
+    return buffer;
+}
+
+//
+// pixel conversion kernels
+//
+// NOTE: bmp pixels are stored as bgr or bgra, the kernels swizzle one row into rgba
+
+void imm_bgr_to_rgba_row_scalar(u8 *dst, u8 *src, u32 width)
+{
+    for(u32 x = 0; x < width; ++x)
+    {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        dst[3] = 0xFF;
+        dst += 4;
+        src += 3;
+    }
+}
+
+// NOTE: every iteration read 16 bytes but only use the 12 of 4 pixels, so the
+// simd loop stops two pixels before the end of the row
+IMM_TARGET("ssse3")
+void imm_bgr_to_rgba_row_ssse3(u8 *dst, u8 *src, u32 width)
+{
+    __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    u32 x = 0;
+    for(; (x + 6) <= width; x += 4)
+    {
+        __m128i bgr = _mm_loadu_si128((__m128i *)(src + x * 3));
+        __m128i rgba = _mm_or_si128(_mm_shuffle_epi8(bgr, shuffle), alpha);
+        _mm_storeu_si128((__m128i *)(dst + x * 4), rgba);
+    }
+    imm_bgr_to_rgba_row_scalar(dst + x * 4, src + x * 3, width - x);
+}
+
+void imm_bgra_to_rgba_row(u8 *dst, u8 *src, u32 width, bool force_alpha)
+{
+    __m128i green_alpha = _mm_set1_epi32((int)0xFF00FF00);
+    __m128i red_blue = _mm_set1_epi32(0x000000FF);
+    __m128i alpha = _mm_set1_epi32(force_alpha ? (int)0xFF000000 : 0);
+    u32 x = 0;
+    for(; (x + 4) <= width; x += 4)
+    {
+        __m128i bgra = _mm_loadu_si128((__m128i *)(src + x * 4));
+        __m128i rgba = _mm_and_si128(bgra, green_alpha);
+        rgba = _mm_or_si128(rgba, _mm_and_si128(_mm_srli_epi32(bgra, 16), red_blue));
+        rgba = _mm_or_si128(rgba, _mm_slli_epi32(_mm_and_si128(bgra, red_blue), 16));
+        _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_or_si128(rgba, alpha));
+    }
+    for(; x < width; ++x)
+    {
+        u8 *s = src + x * 4;
+        u8 *d = dst + x * 4;
+        d[0] = s[2];
+        d[1] = s[1];
+        d[2] = s[0];
+        d[3] = force_alpha ? 0xFF : s[3];
+    }
+}
+
+// NOTE: halve an rgba image averaging every 2x2 block, the source must have
+// (dst_width * 2) x (dst_height * 2) pixels
+void imm_downsample_rgba_2x2(u8 *dst, s32 dst_pitch, u8 *src, s32 src_pitch, u32 dst_width, u32 dst_height)
+{
+    for(u32 y = 0; y < dst_height; ++y)
+    {
+        u8 *row_0 = src + ((s64)(y * 2) * src_pitch);
+        u8 *row_1 = row_0 + src_pitch;
+        u8 *out = dst + ((s64)y * dst_pitch);
+        u32 x = 0;
+        for(; (x + 4) <= dst_width; x += 4)
+        {
+            __m128i a = _mm_avg_epu8(_mm_loadu_si128((__m128i *)(row_0 + x * 8)), _mm_loadu_si128((__m128i *)(row_1 + x * 8)));
+            __m128i b = _mm_avg_epu8(_mm_loadu_si128((__m128i *)(row_0 + x * 8 + 16)), _mm_loadu_si128((__m128i *)(row_1 + x * 8 + 16)));
+            __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_si128((__m128i *)(out + x * 4), _mm_avg_epu8(_mm_castps_si128(even), _mm_castps_si128(odd)));
+        }
+        for(; x < dst_width; ++x)
+        {
+            for(u32 c = 0; c < 4; ++c)
+            {
+                u32 sum = row_0[x * 8 + c] + row_0[x * 8 + 4 + c] + row_1[x * 8 + c] + row_1[x * 8 + 4 + c];
+                out[x * 4 + c] = (u8)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+typedef void imm_bgr_to_rgba_row_t(u8 *dst, u8 *src, u32 width);
+static imm_bgr_to_rgba_row_t *imm_bgr_to_rgba_row;
+
+// NOTE: sdl does not report ssse3, but every cpu with sse4.1 has it
+void imm_texture_init_kernels()
+{
+    imm_bgr_to_rgba_row = SDL_HasSSE41() ? imm_bgr_to_rgba_row_ssse3 : imm_bgr_to_rgba_row_scalar;
+}
+
+//
+// bmp loader
+//
+
+#define imm_bmp_file_header_size 14
+#define imm_bmp_info_header_size 40
+#define imm_bmp_max_dimension 65536
+#define imm_bmp_compression_rgb 0
+#define imm_bmp_compression_bitfields 3
+#define imm_bmp_stream_rows 64
+
+struct imm_bmp_info_t
+{
+    u32 width;
+    u32 height;
+    u32 bpp;
+    u32 row_size;
+    u32 pixel_offset;
+    bool bottom_up;
+    bool has_alpha;
+};
+
+inline u16 imm_read_u16(u8 *data)
+{
+    return (u16)(data[0] | (data[1] << 8));
+}
+
+inline u32 imm_read_u32(u8 *data)
+{
+    return (u32)data[0] | ((u32)data[1] << 8) | ((u32)data[2] << 16) | ((u32)data[3] << 24);
+}
+
+// NOTE: only uncompressed 24 and 32 bits bmps are supported, 32 bits bitfields
+// are accepted when the masks are the standard bgra ones
+bool imm_bmp_read_info(FILE *file, const char *path, imm_bmp_info_t *info)
+{
+    u64 file_size = imm_file_size(file);
+
+    // NOTE: file header, info header and the masks of the v4 header
+    u8 header[imm_bmp_file_header_size + 56] = {};
+    if(file_size < (imm_bmp_file_header_size + imm_bmp_info_header_size) ||
+       fread(header, 1, (size_t)u32_min_2((u32)sizeof(header), (u32)file_size), file) < (imm_bmp_file_header_size + imm_bmp_info_header_size))
+    {
+        printf("[bmp-error]: %s is too small\n", path);
+        return false;
+    }
+    if(header[0] != 'B' || header[1] != 'M')
+    {
+        printf("[bmp-error]: %s is not a bmp file\n", path);
+        return false;
+    }
+
+    u8 *info_header = header + imm_bmp_file_header_size;
+    u32 info_size = imm_read_u32(info_header + 0);
+    s32 width = (s32)imm_read_u32(info_header + 4);
+    s32 height = (s32)imm_read_u32(info_header + 8);
+    u16 planes = imm_read_u16(info_header + 12);
+    u16 bpp = imm_read_u16(info_header + 14);
+    u32 compression = imm_read_u32(info_header + 16);
+
+    if(info_size < imm_bmp_info_header_size)
+    {
+        printf("[bmp-error]: %s uses an unsupported os/2 header\n", path);
+        return false;
+    }
+    if(width <= 0 || height == 0 || width > imm_bmp_max_dimension ||
+       height > imm_bmp_max_dimension || height < -imm_bmp_max_dimension || planes != 1)
+    {
+        printf("[bmp-error]: %s has invalid dimensions %d x %d\n", path, width, height);
+        return false;
+    }
+    if(bpp != 24 && bpp != 32)
+    {
+        printf("[bmp-error]: %s has unsupported %u bits per pixel\n", path, bpp);
+        return false;
+    }
+
+    info->has_alpha = false;
+    if(compression == imm_bmp_compression_bitfields && bpp == 32)
+    {
+        // NOTE: the masks follow a 40 bytes header or are part of the v4/v5 header
+        u8 *masks = info_header + imm_bmp_info_header_size;
+        u32 red = imm_read_u32(masks + 0);
+        u32 green = imm_read_u32(masks + 4);
+        u32 blue = imm_read_u32(masks + 8);
+        u32 alpha = info_size >= 56 ? imm_read_u32(masks + 12) : 0;
+        if(red != 0x00FF0000 || green != 0x0000FF00 || blue != 0x000000FF || (alpha && alpha != 0xFF000000))
+        {
+            printf("[bmp-error]: %s uses unsupported bitfields\n", path);
+            return false;
+        }
+        info->has_alpha = alpha != 0;
+    }
+    else if(compression != imm_bmp_compression_rgb)
+    {
+        printf("[bmp-error]: %s uses unsupported compression %u\n", path, compression);
+        return false;
+    }
+
+    info->width = (u32)width;
+    info->height = (u32)(height < 0 ? -height : height);
+    info->bottom_up = height > 0;
+    info->bpp = bpp;
+    info->row_size = ((info->width * bpp + 31) / 32) * 4;
+    info->pixel_offset = imm_read_u32(header + 10);
+
+    u64 pixel_size = (u64)info->row_size * (u64)info->height;
+    if(info->pixel_offset < (imm_bmp_file_header_size + info_size) || (info->pixel_offset + pixel_size) > file_size)
+    {
+        printf("[bmp-error]: %s is truncated\n", path);
+        return false;
+    }
+    return true;
+}
+
+// NOTE: decode the image rows [first_row, first_row + row_count) counting from the
+// top of the image. The file is read in blocks of rows that are converted and 
+// flipped directly into dst, so the full file is never in memory
+bool imm_bmp_decode_rows(FILE *file, imm_bmp_info_t *info, u32 first_row, u32 row_count, u8 *dst, s32 dst_pitch)
+{
+    u8 *rows = (u8 *)imm_alloc(info->row_size * imm_bmp_stream_rows, memory_tag_file_io);
+
+    bool result = true;
+    for(u32 row = 0; row < row_count; row += imm_bmp_stream_rows)
+    {
+        u32 block_count = u32_min_2(imm_bmp_stream_rows, row_count - row);
+        u32 block_first = first_row + row;
+        // NOTE: in bottom up files the block is stored backwards ending in the first row
+        u32 file_row = info->bottom_up ? (info->height - block_first - block_count) : block_first;
+        imm_file_seek(file, info->pixel_offset + ((u64)file_row * info->row_size));
+        if(fread(rows, info->row_size, block_count, file) != block_count)
+        {
+            result = false;
+            break;
+        }
+        for(u32 i = 0; i < block_count; ++i)
+        {
+            u32 y = info->bottom_up ? (row + block_count - 1 - i) : (row + i);
+            u8 *src = rows + (i * info->row_size);
+            u8 *out = dst + ((s64)y * dst_pitch);
+            if(info->bpp == 24)
+            {
+                imm_bgr_to_rgba_row(out, src, info->width);
+            }
+            else
+            {
+                imm_bgra_to_rgba_row(out, src, info->width, !info->has_alpha);
+            }
+        }
+    }
+
+    imm_free(rows);
+    return result;
+}
+
+bool imm_bmp_decode(FILE *file, imm_bmp_info_t *info, u8 *dst, s32 dst_pitch)
+{
+    return imm_bmp_decode_rows(file, info, 0, info->height, dst, dst_pitch);
+}
+
+imm_texture_t imm_texture_load_bmp(const char *path)
+{
+    imm_texture_t texture = {};
+    FILE *file = fopen(path, "rb");
+    if(!file)
+    {
+        printf("[bmp-error]: could not open %s\n", path);
+        return texture;
+    }
+
+    imm_bmp_info_t info;
+    if(imm_bmp_read_info(file, path, &info))
+    {
+        texture.width = info.width;
+        texture.height = info.height;
+        texture.pitch = info.width * 4;
+        texture.pixels = imm_alloc((u64)texture.pitch * texture.height, memory_tag_texture);
+        if(!imm_bmp_decode(file, &info, (u8 *)texture.pixels, texture.pitch))
+        {
+            printf("[bmp-error]: fail to read %s\n", path);
+            imm_free(texture.pixels);
+            texture = {};
+        }
+    }
+
+    fclose(file);
+    return texture;
+}
+
+// NOTE: decode straight into the staging memory of the backend and let the driver
+// copy it into the texture, the pixels never live in a cpu side allocation
+imm_texture_t imm_texture_upload_bmp(const char *path)
+{
+    imm_texture_t texture = {};
+    FILE *file = fopen(path, "rb");
+    if(!file)
+    {
+        printf("[bmp-error]: could not open %s\n", path);
+        return texture;
+    }
+
+    imm_bmp_info_t info;
+    if(imm_bmp_read_info(file, path, &info))
+    {
+        u64 size = (u64)info.width * info.height * 4;
+        u8 *pixels = (u8 *)imm_backend->texture_staging_begin(size);
+        bool decoded = pixels && imm_bmp_decode(file, &info, pixels, info.width * 4);
+        if(decoded)
+        {
+            texture.width = info.width;
+            texture.height = info.height;
+            texture.pitch = info.width * 4;
+            texture.texture_id = imm_backend->texture_create(info.width, info.height, texture_format_rgba8, 0);
+        }
+        else
+        {
+            printf("[bmp-error]: fail to read %s\n", path);
+        }
+        imm_backend->texture_staging_end(texture.texture_id, info.width, info.height, texture_format_rgba8);
+    }
+
+    fclose(file);
+    return texture;
+}
+
+void imm_texture_free(imm_texture_t *texture)
+{
+    if(texture)
+    {
+        imm_free(texture->pixels);
+        texture->pixels = 0;
+        if(texture->texture_id)
+        {
+            imm_backend->texture_destroy(texture->texture_id);
+            texture->texture_id = 0;
+        }
+    }
+}
+
+// NOTE: time the cpu decode and the gpu upload path of a bmp, use it with a big image
+void imm_texture_bench_bmp(const char *path, u32 iterations)
+{
+    f64 frequency = (f64)SDL_GetPerformanceFrequency();
+    f64 cpu_ms = 0;
+    f64 gpu_ms = 0;
+    u64 bytes = 0;
+    for(u32 i = 0; i < iterations; ++i)
+    {
+        u64 start = SDL_GetPerformanceCounter();
+        imm_texture_t cpu = imm_texture_load_bmp(path);
+        u64 middle = SDL_GetPerformanceCounter();
+        imm_texture_t gpu = imm_texture_upload_bmp(path);
+        glFinish();
+        u64 end = SDL_GetPerformanceCounter();
+
+        cpu_ms += (f64)(middle - start) * 1000.0 / frequency;
+        gpu_ms += (f64)(end - middle) * 1000.0 / frequency;
+        bytes = (u64)cpu.width * cpu.height * 4;
+        imm_texture_free(&cpu);
+        imm_texture_free(&gpu);
+    }
+    cpu_ms /= iterations;
+    gpu_ms /= iterations;
+    f64 mb = (f64)bytes / (1024.0 * 1024.0);
+    printf("[bmp-bench]: %s %.1f MB, cpu decode %.3f ms (%.1f MB/s), gpu upload %.3f ms (%.1f MB/s)\n",
+           path, mb, cpu_ms, mb / (cpu_ms / 1000.0), gpu_ms, mb / (gpu_ms / 1000.0));
+}
+
+#endif // IMM_TEXTURE_H
@@ -0,0 +1,152 @@
+#ifndef IMM_THREAD_H
+#define IMM_THREAD_H
+
+#include <SDL.h>
+#include <stdio.h>
+#include "imm_core.h"
+
+// NOTE: fixed size job queue served by a pool of sdl threads. Jobs are a function
+// and a pointer, the queue never allocates so it can be fed every frame
+
+typedef void imm_job_function_t(void *data);
+
+struct imm_job_t
+{
+    imm_job_function_t *function;
+    void *data;
+};
+
+#define imm_job_queue_size 1024
+#define imm_job_queue_max_threads 16
+
+struct imm_job_queue_t
+{
+    imm_job_t jobs[imm_job_queue_size];
+    u32 read;
+    u32 write;
+
+    SDL_mutex *mutex;
+    SDL_sem *semaphore;
+    SDL_atomic_t pending;
+    SDL_atomic_t running;
+
+    SDL_Thread *threads[imm_job_queue_max_threads];
+    u32 thread_count;
+};
+
+bool imm_job_pop(imm_job_queue_t *queue, imm_job_t *job)
+{
+    bool result = false;
+    SDL_LockMutex(queue->mutex);
+    if(queue->read != queue->write)
+    {
+        *job = queue->jobs[queue->read];
+        queue->read = (queue->read + 1) % imm_job_queue_size;
+        result = true;
+    }
+    SDL_UnlockMutex(queue->mutex);
+    return result;
+}
+
+int imm_job_worker(void *data)
+{
+    imm_job_queue_t *queue = (imm_job_queue_t *)data;
+    for(;;)
+    {
+        SDL_SemWait(queue->semaphore);
+        imm_job_t job;
+        if(imm_job_pop(queue, &job))
+        {
+            job.function(job.data);
+            SDL_AtomicAdd(&queue->pending, -1);
+        }
+        else if(!SDL_AtomicGet(&queue->running))
+        {
+            break;
+        }
+    }
+    return 0;
+}
+
+void imm_job_queue_init(imm_job_queue_t *queue, u32 thread_count, const char *name)
+{
+    queue->read = 0;
+    queue->write = 0;
+    queue->mutex = SDL_CreateMutex();
+    queue->semaphore = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&queue->pending, 0);
+    SDL_AtomicSet(&queue->running, 1);
+    queue->thread_count = u32_min_2(thread_count, imm_job_queue_max_threads);
+    for(u32 i = 0; i < queue->thread_count; ++i)
+    {
+        queue->threads[i] = SDL_CreateThread(imm_job_worker, name, queue);
+    }
+}
+
+// NOTE: return false if the queue is full, the caller decides to retry or drop the job
+bool imm_job_push(imm_job_queue_t *queue, imm_job_function_t *function, void *data)
+{
+    bool result = false;
+    SDL_LockMutex(queue->mutex);
+    u32 next = (queue->write + 1) % imm_job_queue_size;
+    if(next != queue->read)
+    {
+        queue->jobs[queue->write].function = function;
+        queue->jobs[queue->write].data = data;
+        queue->write = next;
+        SDL_AtomicAdd(&queue->pending, 1);
+        result = true;
+    }
+    SDL_UnlockMutex(queue->mutex);
+    if(result)
+    {
+        SDL_SemPost(queue->semaphore);
+    }
+    return result;
+}
+
+// NOTE: run one job in the calling thread, return false if there was nothing to do
+bool imm_job_queue_help(imm_job_queue_t *queue)
+{
+    if(SDL_SemTryWait(queue->semaphore) != 0)
+    {
+        return false;
+    }
+    imm_job_t job;
+    if(imm_job_pop(queue, &job))
+    {
+        job.function(job.data);
+        SDL_AtomicAdd(&queue->pending, -1);
+    }
+    return true;
+}
+
+// NOTE: the calling thread helps with the jobs until all of them are done
+void imm_job_queue_wait(imm_job_queue_t *queue)
+{
+    while(SDL_AtomicGet(&queue->pending))
+    {
+        if(!imm_job_queue_help(queue))
+        {
+            SDL_Delay(0);
+        }
+    }
+}
+
+void imm_job_queue_shutdown(imm_job_queue_t *queue)
+{
+    SDL_AtomicSet(&queue->running, 0);
+    for(u32 i = 0; i < queue->thread_count; ++i)
+    {
+        SDL_SemPost(queue->semaphore);
+    }
+    for(u32 i = 0; i < queue->thread_count; ++i)
+    {
+        SDL_WaitThread(queue->threads[i], 0);
+    }
+    SDL_DestroySemaphore(queue->semaphore);
+    SDL_DestroyMutex(queue->mutex);
+    queue->thread_count = 0;
+}
+
+#endif // IMM_THREAD_H
@@ -0,0 +1,548 @@
+#ifndef IMM_THUMBNAIL_H
+#define IMM_THUMBNAIL_H
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _MSC_VER
+#include <direct.h>
+#endif
+#include "imm_math.h"
+#include "imm_memory.h"
+#include "imm_texture.h"
+#include "imm_thread.h"
+#include "imm_backend.h"
+#include "imm_state.h"
+#include "imm_resample.h"
+
+// NOTE: small versions of many images for grids. The first time an image is asked
+// a worker decodes it, reduces it with the resample kernels and writes the result to
+// a cache file named after the hash of the path. The file keeps the path, the mtime
+// and the size of the source, so a later run only reads a few kilobytes per image
+// and an edited source is generated again. Resident thumbnails live in the slots of
+// one texture with a lru like the tiled images, a small hash index of the slots by
+// the 64 bits hash of their path finds them. The slots keep the path too, so two
+// paths with the same hash never share a thumbnail
+
+#define imm_thumbnail_file_magic 0x4E4D4D49 // NOTE: 'IMMN'
+#define imm_thumbnail_file_version 1
+#define imm_thumbnail_max_size 128
+#define imm_thumbnail_cache_side 16
+#define imm_thumbnail_cache_slots (imm_thumbnail_cache_side * imm_thumbnail_cache_side)
+#define imm_thumbnail_max_in_flight 32
+#define imm_thumbnail_uploads_per_frame 16
+#define imm_thumbnail_max_path 512
+// NOTE: twice the slots so the linear probes of the index stay short
+#define imm_thumbnail_index_size (imm_thumbnail_cache_slots * 2)
+
+// NOTE: followed by the path of the source and the rgba rows of the thumbnail
+struct imm_thumbnail_file_header_t
+{
+    u32 magic;
+    u32 version;
+    u64 source_mtime;
+    u64 source_size;
+    u32 size;
+    u32 filter;
+    u32 width;
+    u32 height;
+    u32 path_length;
+    u32 padding;
+};
+
+enum imm_thumbnail_state_t
+{
+    thumbnail_empty,
+    thumbnail_loading,
+    thumbnail_ready,
+    thumbnail_failed,
+};
+
+struct imm_thumbnail_slot_t
+{
+    u64 path_hash;
+    u32 width;
+    u32 height;
+    u32 last_used;
+    imm_thumbnail_state_t state;
+    char path[imm_thumbnail_max_path];
+};
+
+struct imm_thumbnail_cache_t;
+
+struct imm_thumbnail_request_t
+{
+    imm_thumbnail_cache_t *cache;
+    u32 slot;
+    char path[imm_thumbnail_max_path];
+    // NOTE: size x size rgba, the thumbnail is in the top left corner
+    u8 *staging;
+    u32 width;
+    u32 height;
+    bool failed;
+    bool cached;
+    u64 ticks;
+};
+
+struct imm_thumbnail_stats_t
+{
+    u64 requested;
+    u64 cache_hits;
+    u64 generated;
+    u64 failed;
+    u64 cache_ticks;
+    u64 generate_ticks;
+};
+
+struct imm_thumbnail_cache_t
+{
+    imm_job_queue_t *queue;
+    char directory[256];
+    u32 size;
+    imm_resample_filter_t filter;
+
+    u32 texture_id;
+    imm_thumbnail_slot_t slots[imm_thumbnail_cache_slots];
+    // NOTE: slot of every used entry, -1 when the entry is free
+    s16 index[imm_thumbnail_index_size];
+    u32 frame;
+
+    imm_thumbnail_request_t requests[imm_thumbnail_max_in_flight];
+    u32 free_requests[imm_thumbnail_max_in_flight];
+    u32 free_request_count;
+
+    // NOTE: requests finished by the workers waiting for the upload
+    SDL_mutex *done_mutex;
+    u32 done[imm_thumbnail_max_in_flight];
+    u32 done_count;
+
+    imm_thumbnail_stats_t stats;
+};
+
+// NOTE: the part of the cache texture with the thumbnail and its size in pixels
+struct imm_thumbnail_draw_t
+{
+    u32 texture_id;
+    v2 min_uv;
+    v2 max_uv;
+    u32 width;
+    u32 height;
+};
+
+void imm_make_directory(const char *path)
+{
+#ifdef _MSC_VER
+    _mkdir(path);
+#else
+    mkdir(path, 0755);
+#endif
+}
+
+bool imm_thumbnail_cache_init(imm_thumbnail_cache_t *cache, imm_job_queue_t *queue, const char *directory, u32 size, imm_resample_filter_t filter)
+{
+    memset(cache, 0, sizeof(*cache));
+    if(size == 0 || size > imm_thumbnail_max_size)
+    {
+        printf("[thumbnail-error]: size %u is not in 1..%u\n", size, imm_thumbnail_max_size);
+        return false;
+    }
+    cache->queue = queue;
+    snprintf(cache->directory, sizeof(cache->directory), "%s", directory);
+    cache->size = size;
+    cache->filter = filter;
+    imm_make_directory(cache->directory);
+    memset(cache->index, 0xFF, sizeof(cache->index));
+
+    cache->done_mutex = SDL_CreateMutex();
+    for(u32 i = 0; i < imm_thumbnail_max_in_flight; ++i)
+    {
+        cache->requests[i].cache = cache;
+        cache->requests[i].staging = (u8 *)imm_alloc((u64)size * size * 4, memory_tag_thumbnails);
+        cache->free_requests[i] = i;
+    }
+    cache->free_request_count = imm_thumbnail_max_in_flight;
+
+    u32 side = imm_thumbnail_cache_side * size;
+    cache->texture_id = imm_backend->texture_create(side, side, texture_format_rgba8, 0);
+    return true;
+}
+
+void imm_thumbnail_cache_shutdown(imm_thumbnail_cache_t *cache)
+{
+    if(!cache->texture_id)
+    {
+        return;
+    }
+    // NOTE: the workers may still be writing into the staging buffers
+    imm_job_queue_wait(cache->queue);
+    for(u32 i = 0; i < imm_thumbnail_max_in_flight; ++i)
+    {
+        imm_free(cache->requests[i].staging);
+    }
+    imm_backend->texture_destroy(cache->texture_id);
+    SDL_DestroyMutex(cache->done_mutex);
+    cache->texture_id = 0;
+}
+
+inline u64 imm_thumbnail_path_hash(const char *path)
+{
+    return imm_hash_64(path, strlen(path));
+}
+
+void imm_thumbnail_file_path(imm_thumbnail_cache_t *cache, const char *path, char *buffer, u32 size)
+{
+    snprintf(buffer, size, "%s/%016llx_%u.thumb", cache->directory, (unsigned long long)imm_thumbnail_path_hash(path), cache->size);
+}
+
+// NOTE: false when there is no cache file or it was made from another source, another
+// version of the source or with other settings
+bool imm_thumbnail_read(imm_thumbnail_request_t *request, u64 mtime, u64 source_size)
+{
+    imm_thumbnail_cache_t *cache = request->cache;
+    char file_path[512];
+    imm_thumbnail_file_path(cache, request->path, file_path, sizeof(file_path));
+    FILE *file = fopen(file_path, "rb");
+    if(!file)
+    {
+        return false;
+    }
+
+    bool result = false;
+    u32 path_length = (u32)strlen(request->path);
+    imm_thumbnail_file_header_t header;
+    char path[imm_thumbnail_max_path];
+    if(fread(&header, sizeof(header), 1, file) == 1 && header.magic == imm_thumbnail_file_magic &&
+       header.version == imm_thumbnail_file_version && header.source_mtime == mtime &&
+       header.source_size == source_size && header.size == cache->size && header.filter == (u32)cache->filter &&
+       header.width && header.width <= cache->size && header.height && header.height <= cache->size &&
+       header.path_length == path_length && fread(path, path_length, 1, file) == 1 &&
+       memcmp(path, request->path, path_length) == 0)
+    {
+        result = true;
+        for(u32 y = 0; (y < header.height) && result; ++y)
+        {
+            result = fread(request->staging + (u64)y * cache->size * 4, header.width * 4, 1, file) == 1;
+        }
+        request->width = header.width;
+        request->height = header.height;
+    }
+    fclose(file);
+    return result;
+}
+
+void imm_thumbnail_write(imm_thumbnail_request_t *request, u64 mtime, u64 source_size)
+{
+    imm_thumbnail_cache_t *cache = request->cache;
+    char file_path[512];
+    imm_thumbnail_file_path(cache, request->path, file_path, sizeof(file_path));
+    FILE *file = fopen(file_path, "wb");
+    if(!file)
+    {
+        printf("[thumbnail-error]: could not create %s\n", file_path);
+        return;
+    }
+
+    imm_thumbnail_file_header_t header = {};
+    header.magic = imm_thumbnail_file_magic;
+    header.version = imm_thumbnail_file_version;
+    header.source_mtime = mtime;
+    header.source_size = source_size;
+    header.size = cache->size;
+    header.filter = cache->filter;
+    header.width = request->width;
+    header.height = request->height;
+    header.path_length = (u32)strlen(request->path);
+    bool result = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(request->path, header.path_length, 1, file) == 1;
+    for(u32 y = 0; (y < header.height) && result; ++y)
+    {
+        result = fwrite(request->staging + (u64)y * cache->size * 4, header.width * 4, 1, file) == 1;
+    }
+    fclose(file);
+    if(!result)
+    {
+        // NOTE: a truncated file would fail the read anyway, do not leave it around
+        printf("[thumbnail-error]: fail to write %s\n", file_path);
+        remove(file_path);
+    }
+}
+
+// NOTE: the source is reduced with 2x2 boxes first, the filter then only works on
+// a source at most 4 times bigger than the thumbnail
+bool imm_thumbnail_generate(imm_thumbnail_request_t *request)
+{
+    imm_thumbnail_cache_t *cache = request->cache;
+    imm_texture_t src = imm_texture_load_bmp(request->path);
+    if(!src.pixels)
+    {
+        return false;
+    }
+
+    // NOTE: fit in size x size keeping the aspect, small images are not enlarged
+    u32 width = src.width;
+    u32 height = src.height;
+    if(width > cache->size || height > cache->size)
+    {
+        if(width >= height)
+        {
+            height = u32_max_2(1, (u32)(((u64)height * cache->size + width / 2) / width));
+            width = cache->size;
+        }
+        else
+        {
+            width = u32_max_2(1, (u32)(((u64)width * cache->size + height / 2) / height));
+            height = cache->size;
+        }
+    }
+
+    imm_texture_t reduced = imm_resample_mip_reduce(&src, width, height);
+    imm_texture_t dst = {};
+    dst.pixels = request->staging;
+    dst.width = width;
+    dst.height = height;
+    dst.pitch = cache->size * 4;
+    imm_resample(&dst, reduced.pixels ? &reduced : &src, cache->filter);
+    request->width = width;
+    request->height = height;
+
+    imm_free(reduced.pixels);
+    imm_texture_free(&src);
+    return true;
+}
+
+void imm_thumbnail_job(void *data)
+{
+    imm_thumbnail_request_t *request = (imm_thumbnail_request_t *)data;
+    imm_thumbnail_cache_t *cache = request->cache;
+
+    u64 start = SDL_GetPerformanceCounter();
+    u64 mtime = 0;
+    u64 source_size = 0;
+    request->failed = !imm_file_stat(request->path, &mtime, &source_size);
+    request->cached = false;
+    if(!request->failed)
+    {
+        request->cached = imm_thumbnail_read(request, mtime, source_size);
+        if(!request->cached)
+        {
+            request->failed = !imm_thumbnail_generate(request);
+            if(!request->failed)
+            {
+                imm_thumbnail_write(request, mtime, source_size);
+            }
+        }
+    }
+    request->ticks = SDL_GetPerformanceCounter() - start;
+
+    SDL_LockMutex(cache->done_mutex);
+    cache->done[cache->done_count++] = (u32)(request - cache->requests);
+    SDL_UnlockMutex(cache->done_mutex);
+}
+
+s32 imm_thumbnail_find(imm_thumbnail_cache_t *cache, const char *path, u64 path_hash)
+{
+    u32 mask = imm_thumbnail_index_size - 1;
+    for(u32 i = (u32)path_hash & mask;; i = (i + 1) & mask)
+    {
+        s32 index = cache->index[i];
+        if(index < 0)
+        {
+            return -1;
+        }
+        imm_thumbnail_slot_t *slot = cache->slots + index;
+        if(slot->path_hash == path_hash && strcmp(slot->path, path) == 0)
+        {
+            return index;
+        }
+    }
+}
+
+void imm_thumbnail_index_add(imm_thumbnail_cache_t *cache, u32 slot_index)
+{
+    u32 mask = imm_thumbnail_index_size - 1;
+    u32 i = (u32)cache->slots[slot_index].path_hash & mask;
+    while(cache->index[i] >= 0)
+    {
+        i = (i + 1) & mask;
+    }
+    cache->index[i] = (s16)slot_index;
+}
+
+// NOTE: the entries after the removed one are moved back when the hole is between
+// them and their home, so the probes never stop early on the hole
+void imm_thumbnail_index_remove(imm_thumbnail_cache_t *cache, u32 slot_index)
+{
+    u32 mask = imm_thumbnail_index_size - 1;
+    u32 i = (u32)cache->slots[slot_index].path_hash & mask;
+    while(cache->index[i] != (s32)slot_index)
+    {
+        i = (i + 1) & mask;
+    }
+    cache->index[i] = -1;
+    for(u32 j = (i + 1) & mask; cache->index[j] >= 0; j = (j + 1) & mask)
+    {
+        u32 home = (u32)cache->slots[cache->index[j]].path_hash & mask;
+        if(((j - home) & mask) >= ((j - i) & mask))
+        {
+            cache->index[i] = cache->index[j];
+            cache->index[j] = -1;
+            i = j;
+        }
+    }
+}
+
+// NOTE: pick an empty slot or the least recently used one that is not visible this frame
+void imm_thumbnail_request(imm_thumbnail_cache_t *cache, const char *path, u64 path_hash)
+{
+    u32 path_length = (u32)strlen(path);
+    if(cache->free_request_count == 0 || path_length >= imm_thumbnail_max_path)
+    {
+        return;
+    }
+
+    s32 victim = -1;
+    for(u32 i = 0; i < imm_thumbnail_cache_slots; ++i)
+    {
+        imm_thumbnail_slot_t *slot = cache->slots + i;
+        if(slot->state == thumbnail_empty)
+        {
+            victim = (s32)i;
+            break;
+        }
+        if(slot->state != thumbnail_loading && slot->last_used != cache->frame &&
+           (victim < 0 || slot->last_used < cache->slots[victim].last_used))
+        {
+            victim = (s32)i;
+        }
+    }
+    if(victim < 0)
+    {
+        return;
+    }
+
+    u32 request_index = cache->free_requests[--cache->free_request_count];
+    imm_thumbnail_request_t *request = cache->requests + request_index;
+    request->slot = (u32)victim;
+    memcpy(request->path, path, path_length + 1);
+
+    imm_thumbnail_slot_t *slot = cache->slots + victim;
+    if(slot->state != thumbnail_empty)
+    {
+        imm_thumbnail_index_remove(cache, (u32)victim);
+    }
+    slot->path_hash = path_hash;
+    memcpy(slot->path, path, path_length + 1);
+    slot->state = thumbnail_loading;
+    slot->last_used = cache->frame;
+    imm_thumbnail_index_add(cache, (u32)victim);
+
+    if(imm_job_push(cache->queue, imm_thumbnail_job, request))
+    {
+        cache->stats.requested++;
+    }
+    else
+    {
+        imm_thumbnail_index_remove(cache, (u32)victim);
+        slot->state = thumbnail_empty;
+        cache->free_requests[cache->free_request_count++] = request_index;
+    }
+}
+
+// NOTE: the state of the thumbnail of path, draw is filled when it is ready. The
+// thumbnail is requested when it is not in the cache
+imm_thumbnail_state_t imm_thumbnail_get(imm_thumbnail_cache_t *cache, const char *path, imm_thumbnail_draw_t *draw)
+{
+    if(!cache->texture_id)
+    {
+        return thumbnail_failed;
+    }
+    u64 path_hash = imm_thumbnail_path_hash(path);
+    s32 index = imm_thumbnail_find(cache, path, path_hash);
+    if(index < 0)
+    {
+        imm_thumbnail_request(cache, path, path_hash);
+        return thumbnail_loading;
+    }
+
+    imm_thumbnail_slot_t *slot = cache->slots + index;
+    slot->last_used = cache->frame;
+    if(slot->state == thumbnail_ready)
+    {
+        // NOTE: half texel inset so the linear filter does not read the next slot
+        f32 texel = 1.0f / (f32)(imm_thumbnail_cache_side * cache->size);
+        v2 origin = _v2((f32)(index % imm_thumbnail_cache_side) * cache->size, (f32)(index / imm_thumbnail_cache_side) * cache->size);
+        draw->texture_id = cache->texture_id;
+        draw->min_uv = (origin + _v2(0.5f, 0.5f)) * texel;
+        draw->max_uv = (origin + _v2((f32)slot->width - 0.5f, (f32)slot->height - 0.5f)) * texel;
+        draw->width = slot->width;
+        draw->height = slot->height;
+    }
+    return slot->state;
+}
+
+// NOTE: upload the thumbnails finished by the workers, a few per frame so the frame never stalls
+void imm_thumbnail_cache_update(imm_thumbnail_cache_t *cache)
+{
+    if(!cache->texture_id)
+    {
+        return;
+    }
+    cache->frame++;
+
+    u32 done[imm_thumbnail_max_in_flight];
+    u32 done_count = 0;
+    SDL_LockMutex(cache->done_mutex);
+    done_count = u32_min_2(cache->done_count, imm_thumbnail_uploads_per_frame);
+    memcpy(done, cache->done, done_count * sizeof(u32));
+    memmove(cache->done, cache->done + done_count, (cache->done_count - done_count) * sizeof(u32));
+    cache->done_count -= done_count;
+    SDL_UnlockMutex(cache->done_mutex);
+
+    for(u32 i = 0; i < done_count; ++i)
+    {
+        imm_thumbnail_request_t *request = cache->requests + done[i];
+        imm_thumbnail_slot_t *slot = cache->slots + request->slot;
+        if(request->failed)
+        {
+            // NOTE: kept in the slot so a missing file is not requested every frame
+            slot->state = thumbnail_failed;
+            cache->stats.failed++;
+        }
+        else
+        {
+            u32 slot_x = (request->slot % imm_thumbnail_cache_side) * cache->size;
+            u32 slot_y = (request->slot / imm_thumbnail_cache_side) * cache->size;
+            imm_backend->texture_update(cache->texture_id, slot_x, slot_y, request->width, request->height, texture_format_rgba8, request->staging, cache->size * 4);
+            slot->width = request->width;
+            slot->height = request->height;
+            slot->state = thumbnail_ready;
+            if(request->cached)
+            {
+                cache->stats.cache_hits++;
+                cache->stats.cache_ticks += request->ticks;
+            }
+            else
+            {
+                cache->stats.generated++;
+                cache->stats.generate_ticks += request->ticks;
+            }
+        }
+        cache->free_requests[cache->free_request_count++] = done[i];
+    }
+}
+
+void imm_thumbnail_stats_print(imm_thumbnail_cache_t *cache)
+{
+    imm_thumbnail_stats_t *stats = &cache->stats;
+    f64 frequency = (f64)SDL_GetPerformanceFrequency();
+    printf("[thumbnail]: %llu requested, %llu from the cache %.3f ms each, %llu generated %.3f ms each, %llu failed\n",
+           (unsigned long long)stats->requested, (unsigned long long)stats->cache_hits,
+           stats->cache_hits ? (f64)stats->cache_ticks * 1000.0 / frequency / (f64)stats->cache_hits : 0.0,
+           (unsigned long long)stats->generated,
+           stats->generated ? (f64)stats->generate_ticks * 1000.0 / frequency / (f64)stats->generated : 0.0,
+           (unsigned long long)stats->failed);
+}
+
+#endif // IMM_THUMBNAIL_H
@@ -0,0 +1,533 @@
+#ifndef IMM_TILED_IMAGE_H
+#define IMM_TILED_IMAGE_H
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "imm_math.h"
+#include "imm_memory.h"
+#include "imm_texture.h"
+#include "imm_thread.h"
+#include "imm_backend.h"
+
+// NOTE: images that do not fit in memory are converted once to a tile pyramid on
+// disk. Every level is half the size of the previous one and is split in tiles of
+// 256x256 rgba pixels stored row by row at fixed offsets, the file can be read with
+// plain seeks or memory mapped. While drawing only the visible tiles of the right
+// level are loaded, in background threads, into a fixed size cache texture
+
+#define imm_tile_size 256
+#define imm_tile_bytes (imm_tile_size * imm_tile_size * 4)
+#define imm_tile_max_levels 24
+#define imm_tile_file_magic 0x544D4D49
+#define imm_tile_file_version 1
+#define imm_tile_header_size 4096
+
+struct imm_tile_level_t
+{
+    u32 width;
+    u32 height;
+    u32 tiles_x;
+    u32 tiles_y;
+    u64 offset;
+};
+
+struct imm_tile_file_header_t
+{
+    u32 magic;
+    u32 version;
+    u32 width;
+    u32 height;
+    u32 tile_size;
+    u32 level_count;
+    imm_tile_level_t levels[imm_tile_max_levels];
+};
+
+inline u64 imm_tile_offset(imm_tile_file_header_t *header, u32 level, u32 x, u32 y)
+{
+    imm_tile_level_t *l = header->levels + level;
+    return l->offset + ((u64)y * l->tiles_x + x) * imm_tile_bytes;
+}
+
+void imm_tile_header_init(imm_tile_file_header_t *header, u32 width, u32 height)
+{
+    memset(header, 0, sizeof(*header));
+    header->magic = imm_tile_file_magic;
+    header->version = imm_tile_file_version;
+    header->width = width;
+    header->height = height;
+    header->tile_size = imm_tile_size;
+
+    u64 offset = imm_tile_header_size;
+    for(u32 level = 0; level < imm_tile_max_levels; ++level)
+    {
+        imm_tile_level_t *l = header->levels + level;
+        l->width = width;
+        l->height = height;
+        l->tiles_x = (width + imm_tile_size - 1) / imm_tile_size;
+        l->tiles_y = (height + imm_tile_size - 1) / imm_tile_size;
+        l->offset = offset;
+        offset += (u64)l->tiles_x * l->tiles_y * imm_tile_bytes;
+        header->level_count++;
+        if(l->tiles_x == 1 && l->tiles_y == 1)
+        {
+            break;
+        }
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+}
+
+// NOTE: the bmp is read in strips of one tile row, so only one strip of the
+// original image is in memory. The upper levels are build from the tiles of the
+// level below already written to the file
+bool imm_tiled_image_build(const char *bmp_path, const char *tiles_path)
+{
+    FILE *bmp = fopen(bmp_path, "rb");
+    if(!bmp)
+    {
+        printf("[tiles-error]: could not open %s\n", bmp_path);
+        return false;
+    }
+    imm_bmp_info_t info;
+    if(!imm_bmp_read_info(bmp, bmp_path, &info))
+    {
+        fclose(bmp);
+        return false;
+    }
+    FILE *file = fopen(tiles_path, "w+b");
+    if(!file)
+    {
+        printf("[tiles-error]: could not create %s\n", tiles_path);
+        fclose(bmp);
+        return false;
+    }
+
+    u64 start = SDL_GetPerformanceCounter();
+
+    imm_tile_file_header_t header;
+    imm_tile_header_init(&header, info.width, info.height);
+    u8 *header_block = (u8 *)imm_alloc_zero(imm_tile_header_size, memory_tag_file_io);
+    memcpy(header_block, &header, sizeof(header));
+    bool result = fwrite(header_block, imm_tile_header_size, 1, file) == 1;
+    imm_free(header_block);
+
+    u8 *tile = (u8 *)imm_alloc(imm_tile_bytes, memory_tag_tiles);
+    u8 *child = (u8 *)imm_alloc(imm_tile_bytes, memory_tag_tiles);
+    u8 *strip = (u8 *)imm_alloc((u64)info.width * imm_tile_size * 4, memory_tag_tiles);
+    s32 strip_pitch = info.width * 4;
+
+    imm_tile_level_t *base = header.levels;
+    for(u32 ty = 0; (ty < base->tiles_y) && result; ++ty)
+    {
+        u32 rows = u32_min_2(imm_tile_size, info.height - ty * imm_tile_size);
+        result = imm_bmp_decode_rows(bmp, &info, ty * imm_tile_size, rows, strip, strip_pitch);
+        for(u32 tx = 0; (tx < base->tiles_x) && result; ++tx)
+        {
+            u32 columns = u32_min_2(imm_tile_size, info.width - tx * imm_tile_size);
+            memset(tile, 0, imm_tile_bytes);
+            for(u32 y = 0; y < rows; ++y)
+            {
+                memcpy(tile + y * imm_tile_size * 4, strip + ((u64)y * strip_pitch) + (tx * imm_tile_size * 4), columns * 4);
+            }
+            result = (imm_file_seek(file, imm_tile_offset(&header, 0, tx, ty)) == 0) &&
+                     (fwrite(tile, imm_tile_bytes, 1, file) == 1);
+        }
+    }
+
+    for(u32 level = 1; (level < header.level_count) && result; ++level)
+    {
+        imm_tile_level_t *l = header.levels + level;
+        imm_tile_level_t *below = header.levels + level - 1;
+        for(u32 ty = 0; (ty < l->tiles_y) && result; ++ty)
+        {
+            for(u32 tx = 0; (tx < l->tiles_x) && result; ++tx)
+            {
+                memset(tile, 0, imm_tile_bytes);
+                for(u32 quadrant = 0; quadrant < 4; ++quadrant)
+                {
+                    u32 cx = tx * 2 + (quadrant & 1);
+                    u32 cy = ty * 2 + (quadrant >> 1);
+                    if(cx >= below->tiles_x || cy >= below->tiles_y)
+                    {
+                        continue;
+                    }
+                    imm_file_seek(file, imm_tile_offset(&header, level - 1, cx, cy));
+                    if(fread(child, imm_tile_bytes, 1, file) != 1)
+                    {
+                        result = false;
+                        continue;
+                    }
+                    u8 *dst = tile + ((quadrant >> 1) * (imm_tile_size / 2) * imm_tile_size * 4) + ((quadrant & 1) * (imm_tile_size / 2) * 4);
+                    imm_downsample_rgba_2x2(dst, imm_tile_size * 4, child, imm_tile_size * 4, imm_tile_size / 2, imm_tile_size / 2);
+                }
+                result = result && (imm_file_seek(file, imm_tile_offset(&header, level, tx, ty)) == 0) &&
+                         (fwrite(tile, imm_tile_bytes, 1, file) == 1);
+            }
+        }
+    }
+
+    imm_free(strip);
+    imm_free(child);
+    imm_free(tile);
+    // NOTE: the last buffered writes can still fail in the close
+    result = (fclose(file) == 0) && result;
+    fclose(bmp);
+
+    if(!result)
+    {
+        // NOTE: a truncated pyramid would be accepted by imm_tiled_image_open, do not leave it around
+        printf("[tiles-error]: fail to build %s\n", tiles_path);
+        remove(tiles_path);
+        return false;
+    }
+    f64 ms = (f64)(SDL_GetPerformanceCounter() - start) * 1000.0 / (f64)SDL_GetPerformanceFrequency();
+    printf("[tiles]: %s %u x %u, %u levels build in %.1f ms\n", tiles_path, info.width, info.height, header.level_count, ms);
+    return result;
+}
+
+//
+// tile cache
+//
+// NOTE: the cache texture is a grid of tile slots replaced in lru order. The main
+// thread decides which tile goes in which slot and the workers only read the tile
+// from disk into a staging buffer, the upload happens in imm_tiled_image_update
+
+#define imm_tile_cache_side 16
+#define imm_tile_cache_slots (imm_tile_cache_side * imm_tile_cache_side)
+#define imm_tile_max_in_flight 32
+#define imm_tile_uploads_per_frame 8
+
+enum imm_tile_slot_state_t
+{
+    tile_slot_empty,
+    tile_slot_loading,
+    tile_slot_resident,
+};
+
+struct imm_tile_slot_t
+{
+    u32 level;
+    u32 x;
+    u32 y;
+    u32 last_used;
+    imm_tile_slot_state_t state;
+    // NOTE: never evicted, the coarsest level is always the last fallback
+    bool pinned;
+};
+
+struct imm_tiled_image_t;
+
+struct imm_tile_request_t
+{
+    imm_tiled_image_t *image;
+    u32 slot;
+    u8 *staging;
+    bool failed;
+};
+
+struct imm_tiled_image_t
+{
+    FILE *file;
+    SDL_mutex *file_mutex;
+    imm_tile_file_header_t header;
+    imm_job_queue_t *queue;
+
+    u32 texture_id;
+    imm_tile_slot_t slots[imm_tile_cache_slots];
+    u32 frame;
+
+    imm_tile_request_t requests[imm_tile_max_in_flight];
+    u32 free_requests[imm_tile_max_in_flight];
+    u32 free_request_count;
+
+    // NOTE: requests finished by the workers waiting for the upload
+    SDL_mutex *done_mutex;
+    u32 done[imm_tile_max_in_flight];
+    u32 done_count;
+};
+
+// NOTE: one visible piece of the image, the rect is in screen space
+struct imm_tile_draw_t
+{
+    rect2d rect;
+    v2 min_uv;
+    v2 max_uv;
+};
+
+void imm_tile_load_job(void *data)
+{
+    imm_tile_request_t *request = (imm_tile_request_t *)data;
+    imm_tiled_image_t *image = request->image;
+    imm_tile_slot_t *slot = image->slots + request->slot;
+
+    SDL_LockMutex(image->file_mutex);
+    imm_file_seek(image->file, imm_tile_offset(&image->header, slot->level, slot->x, slot->y));
+    request->failed = fread(request->staging, imm_tile_bytes, 1, image->file) != 1;
+    SDL_UnlockMutex(image->file_mutex);
+
+    SDL_LockMutex(image->done_mutex);
+    image->done[image->done_count++] = (u32)(request - image->requests);
+    SDL_UnlockMutex(image->done_mutex);
+}
+
+s32 imm_tiled_image_find(imm_tiled_image_t *image, u32 level, u32 x, u32 y)
+{
+    for(u32 i = 0; i < imm_tile_cache_slots; ++i)
+    {
+        imm_tile_slot_t *slot = image->slots + i;
+        if(slot->state != tile_slot_empty && slot->level == level && slot->x == x && slot->y == y)
+        {
+            return (s32)i;
+        }
+    }
+    return -1;
+}
+
+// NOTE: pick an empty slot or the least recently used one that is not visible this
+// frame and not pinned, return the slot or -1 when the tile can not be requested
+s32 imm_tiled_image_request(imm_tiled_image_t *image, u32 level, u32 x, u32 y)
+{
+    if(image->free_request_count == 0)
+    {
+        return -1;
+    }
+
+    s32 victim = -1;
+    for(u32 i = 0; i < imm_tile_cache_slots; ++i)
+    {
+        imm_tile_slot_t *slot = image->slots + i;
+        if(slot->state == tile_slot_empty)
+        {
+            victim = (s32)i;
+            break;
+        }
+        if(slot->state == tile_slot_resident && !slot->pinned && slot->last_used != image->frame &&
+           (victim < 0 || slot->last_used < image->slots[victim].last_used))
+        {
+            victim = (s32)i;
+        }
+    }
+    if(victim < 0)
+    {
+        return -1;
+    }
+
+    u32 request_index = image->free_requests[--image->free_request_count];
+    imm_tile_request_t *request = image->requests + request_index;
+    request->slot = (u32)victim;
+
+    imm_tile_slot_t *slot = image->slots + victim;
+    slot->level = level;
+    slot->x = x;
+    slot->y = y;
+    slot->state = tile_slot_loading;
+    slot->last_used = image->frame;
+    slot->pinned = false;
+
+    if(!imm_job_push(image->queue, imm_tile_load_job, request))
+    {
+        slot->state = tile_slot_empty;
+        image->free_requests[image->free_request_count++] = request_index;
+        return -1;
+    }
+    return victim;
+}
+
+bool imm_tiled_image_open(imm_tiled_image_t *image, const char *path, imm_job_queue_t *queue)
+{
+    memset(image, 0, sizeof(*image));
+    image->file = fopen(path, "rb");
+    if(!image->file)
+    {
+        printf("[tiles-error]: could not open %s\n", path);
+        return false;
+    }
+    if(fread(&image->header, sizeof(image->header), 1, image->file) != 1 ||
+       image->header.magic != imm_tile_file_magic || image->header.version != imm_tile_file_version ||
+       image->header.tile_size != imm_tile_size || image->header.level_count == 0 ||
+       image->header.level_count > imm_tile_max_levels)
+    {
+        printf("[tiles-error]: %s is not a valid tile pyramid\n", path);
+        fclose(image->file);
+        image->file = 0;
+        return false;
+    }
+
+    image->queue = queue;
+    image->file_mutex = SDL_CreateMutex();
+    image->done_mutex = SDL_CreateMutex();
+    for(u32 i = 0; i < imm_tile_max_in_flight; ++i)
+    {
+        image->requests[i].image = image;
+        image->requests[i].staging = (u8 *)imm_alloc(imm_tile_bytes, memory_tag_tiles);
+        image->free_requests[i] = i;
+    }
+    image->free_request_count = imm_tile_max_in_flight;
+
+    u32 side = imm_tile_cache_side * imm_tile_size;
+    image->texture_id = imm_backend->texture_create(side, side, texture_format_rgba8, 0);
+
+    // NOTE: the single tile of the coarsest level is loaded at once and never evicted,
+    // so the first view or a big zoom always has a parent to draw while the tiles load
+    s32 coarsest = imm_tiled_image_request(image, image->header.level_count - 1, 0, 0);
+    if(coarsest >= 0)
+    {
+        image->slots[coarsest].pinned = true;
+    }
+    return true;
+}
+
+void imm_tiled_image_close(imm_tiled_image_t *image)
+{
+    if(!image->file)
+    {
+        return;
+    }
+    // NOTE: the workers may still be reading into the staging buffers
+    imm_job_queue_wait(image->queue);
+    for(u32 i = 0; i < imm_tile_max_in_flight; ++i)
+    {
+        imm_free(image->requests[i].staging);
+    }
+    imm_backend->texture_destroy(image->texture_id);
+    SDL_DestroyMutex(image->file_mutex);
+    SDL_DestroyMutex(image->done_mutex);
+    fclose(image->file);
+    image->file = 0;
+}
+
+// NOTE: upload the tiles loaded by the workers, a few per frame so the frame never stalls
+void imm_tiled_image_update(imm_tiled_image_t *image)
+{
+    if(!image->file)
+    {
+        return;
+    }
+    image->frame++;
+
+    u32 done[imm_tile_max_in_flight];
+    u32 done_count = 0;
+    SDL_LockMutex(image->done_mutex);
+    done_count = u32_min_2(image->done_count, imm_tile_uploads_per_frame);
+    memcpy(done, image->done, done_count * sizeof(u32));
+    memmove(image->done, image->done + done_count, (image->done_count - done_count) * sizeof(u32));
+    image->done_count -= done_count;
+    SDL_UnlockMutex(image->done_mutex);
+
+    for(u32 i = 0; i < done_count; ++i)
+    {
+        imm_tile_request_t *request = image->requests + done[i];
+        imm_tile_slot_t *slot = image->slots + request->slot;
+        if(request->failed)
+        {
+            slot->state = tile_slot_empty;
+        }
+        else
+        {
+            u32 slot_x = (request->slot % imm_tile_cache_side) * imm_tile_size;
+            u32 slot_y = (request->slot / imm_tile_cache_side) * imm_tile_size;
+            imm_backend->texture_update(image->texture_id, slot_x, slot_y, imm_tile_size, imm_tile_size, texture_format_rgba8, request->staging, imm_tile_size * 4);
+            slot->state = tile_slot_resident;
+        }
+        image->free_requests[image->free_request_count++] = done[i];
+    }
+}
+
+// NOTE: the uvs of the part of the slot that cover the visible image rect, tile is
+// the rect in image pixels of the whole tile in the slot
+void imm_tiled_image_slot_draw(u32 slot, rect2d tile, rect2d visible, v2 center, f32 zoom, v2 view_center, imm_tile_draw_t *draw)
+{
+    f32 slot_uv = 1.0f / (f32)imm_tile_cache_side;
+    // NOTE: half texel inset so the linear filter does not read the next slot
+    f32 inset = 0.5f / (f32)(imm_tile_cache_side * imm_tile_size);
+    v2 origin = _v2((f32)(slot % imm_tile_cache_side) * slot_uv + inset, (f32)(slot / imm_tile_cache_side) * slot_uv + inset);
+    f32 uv_size = slot_uv - inset * 2.0f;
+    v2 tile_size = tile.max - tile.min;
+
+    draw->min_uv = origin + _v2((visible.min.x - tile.min.x) / tile_size.x, (visible.min.y - tile.min.y) / tile_size.y) * uv_size;
+    draw->max_uv = origin + _v2((visible.max.x - tile.min.x) / tile_size.x, (visible.max.y - tile.min.y) / tile_size.y) * uv_size;
+    draw->rect.min = view_center + (visible.min - center) * zoom;
+    draw->rect.max = view_center + (visible.max - center) * zoom;
+}
+
+// NOTE: collect the pieces to draw the image inside view with center (in image pixels)
+// in the middle of the view and zoom screen pixels per image pixel. Tiles that are
+// not loaded yet are requested and replaced with the closest loaded parent tile
+u32 imm_tiled_image_visible(imm_tiled_image_t *image, rect2d view, v2 center, f32 zoom, imm_tile_draw_t *draws, u32 max_draws)
+{
+    if(!image->file || zoom <= 0)
+    {
+        return 0;
+    }
+
+    imm_tile_file_header_t *header = &image->header;
+    u32 level = 0;
+    for(f32 scale = zoom; (scale < 0.5f) && ((level + 1) < header->level_count); scale *= 2.0f)
+    {
+        level++;
+    }
+    f32 level_scale = (f32)(1 << level);
+    f32 tile_extent = imm_tile_size * level_scale;
+
+    v2 view_center = (view.min + view.max) * 0.5f;
+    v2 half_view = (view.max - view.min) * (0.5f / zoom);
+    rect2d image_rect = rect2d_min_max(_v2(0, 0), _v2((f32)header->width, (f32)header->height));
+    rect2d visible_rect = rect2d_intersection(rect2d_min_max(center - half_view, center + half_view), image_rect);
+    if(visible_rect.min.x >= visible_rect.max.x || visible_rect.min.y >= visible_rect.max.y)
+    {
+        return 0;
+    }
+
+    imm_tile_level_t *l = header->levels + level;
+    u32 min_tx = (u32)(visible_rect.min.x / tile_extent);
+    u32 min_ty = (u32)(visible_rect.min.y / tile_extent);
+    u32 max_tx = u32_min_2((u32)(visible_rect.max.x / tile_extent), l->tiles_x - 1);
+    u32 max_ty = u32_min_2((u32)(visible_rect.max.y / tile_extent), l->tiles_y - 1);
+
+    u32 count = 0;
+    for(u32 ty = min_ty; ty <= max_ty; ++ty)
+    {
+        for(u32 tx = min_tx; tx <= max_tx; ++tx)
+        {
+            rect2d tile = rect2d_min_dim(_v2(tx * tile_extent, ty * tile_extent), _v2(tile_extent, tile_extent));
+            rect2d visible = rect2d_intersection(tile, visible_rect);
+
+            s32 slot = imm_tiled_image_find(image, level, tx, ty);
+            if(slot >= 0)
+            {
+                image->slots[slot].last_used = image->frame;
+            }
+            if(slot < 0)
+            {
+                imm_tiled_image_request(image, level, tx, ty);
+            }
+            if(slot < 0 || image->slots[slot].state != tile_slot_resident)
+            {
+                // NOTE: fallback to the first resident parent, its image rect contains this tile
+                slot = -1;
+                for(u32 parent = level + 1; parent < header->level_count; ++parent)
+                {
+                    u32 shift = parent - level;
+                    s32 candidate = imm_tiled_image_find(image, parent, tx >> shift, ty >> shift);
+                    if(candidate >= 0 && image->slots[candidate].state == tile_slot_resident)
+                    {
+                        f32 parent_extent = imm_tile_size * (f32)(1 << parent);
+                        tile = rect2d_min_dim(_v2((tx >> shift) * parent_extent, (ty >> shift) * parent_extent), _v2(parent_extent, parent_extent));
+                        image->slots[candidate].last_used = image->frame;
+                        slot = candidate;
+                        break;
+                    }
+                }
+            }
+            if(slot >= 0 && count < max_draws)
+            {
+                imm_tiled_image_slot_draw((u32)slot, tile, visible, center, zoom, view_center, draws + count++);
+            }
+        }
+    }
+    return count;
+}
+
+#endif // IMM_TILED_IMAGE_H
@@ -0,0 +1,139 @@
+#ifndef IMM_VERTEX_FORMAT_H
+#define IMM_VERTEX_FORMAT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "imm_core.h"
+#include "imm_memory.h"
+#include "imm_backend.h"
+
+// NOTE: a vertex format is a plain struct plus a descriptor declared once with
+// imm_vertex_format. The backend layout, the glsl inputs of the vertex shader and
+// the cpu storage of the vertices are all generated from the descriptor, so every
+// kind of primitive can use the smallest vertex it needs and adding a member to a
+// vertex only means adding it to its descriptor. Every member must be made of f32
+
+// NOTE: the location is the position of the attribute in the descriptor and the
+// shader input is called attr_<member>
+#define imm_vertex_attribute(type, member) { 0, (u32)(sizeof(((type *)0)->member) / sizeof(f32)), (u32)offsetof(type, member), "attr_" #member }
+
+template <typename vertex_t> struct imm_vertex_format_t;
+
+#define imm_vertex_format(type, pipeline_index, vertex_capacity, ...)                \
+template <> struct imm_vertex_format_t<type>                                         \
+{                                                                                    \
+    enum { pipeline = pipeline_index, capacity = vertex_capacity };                  \
+    static constexpr imm_vertex_layout_t layout()                                    \
+    {                                                                                \
+        imm_vertex_layout_t result = { { __VA_ARGS__ }, 0, sizeof(type), capacity }; \
+        while((result.attribute_count < imm_backend_max_attributes) &&              \
+              result.attributes[result.attribute_count].count)                      \
+        {                                                                            \
+            result.attributes[result.attribute_count].location = result.attribute_count; \
+            result.attribute_count++;                                                \
+        }                                                                            \
+        return result;                                                               \
+    }                                                                                \
+};
+
+// NOTE: checked at compile time, the attributes must be inside the vertex, in order
+// and without overlapping, and the backend only reads f32 vectors of 1 to 4 values
+constexpr bool imm_vertex_layout_valid(imm_vertex_layout_t layout)
+{
+    if(!layout.attribute_count || !layout.capacity || (layout.stride % sizeof(f32)))
+    {
+        return false;
+    }
+    u32 end = 0;
+    for(u32 i = 0; i < layout.attribute_count; ++i)
+    {
+        imm_vertex_attribute_t attribute = layout.attributes[i];
+        if((attribute.count > 4) || (attribute.offset < end))
+        {
+            return false;
+        }
+        end = attribute.offset + attribute.count * (u32)sizeof(f32);
+    }
+    return end <= layout.stride;
+}
+
+// NOTE: cpu side vertices of one format, the backend gets one stream per pipeline
+struct imm_vertex_stream_t
+{
+    void *vertices;
+    u32 count;
+    u32 capacity;
+    u32 stride;
+};
+
+static imm_vertex_stream_t imm_vertex_streams[imm_backend_max_pipelines];
+
+template <typename vertex_t>
+inline imm_vertex_stream_t *imm_vertex_stream()
+{
+    return imm_vertex_streams + imm_vertex_format_t<vertex_t>::pipeline;
+}
+
+// NOTE: reserve the static storage of the format and write its backend layout in
+// the slot of its pipeline
+template <typename vertex_t>
+void imm_vertex_format_register(imm_vertex_layout_t *layouts)
+{
+    typedef imm_vertex_format_t<vertex_t> format_t;
+    static_assert(imm_vertex_layout_valid(format_t::layout()), "invalid vertex format descriptor");
+    static_assert(format_t::pipeline < imm_backend_max_pipelines, "vertex format pipeline out of range");
+
+    static vertex_t storage[format_t::capacity];
+    imm_vertex_stream_t *stream = imm_vertex_stream<vertex_t>();
+    stream->vertices = storage;
+    stream->count = 0;
+    stream->capacity = format_t::capacity;
+    stream->stride = sizeof(vertex_t);
+    layouts[format_t::pipeline] = format_t::layout();
+    imm_memory_track(memory_tag_vertex, sizeof(storage));
+}
+
+// NOTE: the "layout (location = n) in vecn attr_member;" lines of the layout, they
+// are inserted in the vertex shader after the #version line
+u32 imm_vertex_layout_glsl(imm_vertex_layout_t *layout, char *buffer, u32 size)
+{
+    u32 length = 0;
+    buffer[0] = 0;
+    for(u32 i = 0; i < layout->attribute_count; ++i)
+    {
+        imm_vertex_attribute_t *attribute = layout->attributes + i;
+        char type[8] = "float";
+        if(attribute->count > 1)
+        {
+            snprintf(type, sizeof(type), "vec%u", attribute->count);
+        }
+        int written = snprintf(buffer + length, size - length, "layout (location = %u) in %s %s;\n", attribute->location, type, attribute->name);
+        if((written < 0) || ((u32)written >= (size - length)))
+        {
+            printf("[vertex-format-error]: glsl inputs do not fit in %u bytes\n", size);
+            buffer[length] = 0;
+            break;
+        }
+        length += (u32)written;
+    }
+    return length;
+}
+
+template <typename vertex_t>
+bool imm_vertex_format_program_load(const char *vertex, const char *fragment)
+{
+    imm_vertex_layout_t layout = imm_vertex_format_t<vertex_t>::layout();
+    char inputs[1024];
+    imm_vertex_layout_glsl(&layout, inputs, sizeof(inputs));
+    return imm_backend->program_load(imm_vertex_format_t<vertex_t>::pipeline, vertex, fragment, inputs);
+}
+
+void imm_vertex_streams_reset()
+{
+    for(u32 i = 0; i < imm_backend_max_pipelines; ++i)
+    {
+        imm_vertex_streams[i].count = 0;
+    }
+}
+
+#endif // IMM_VERTEX_FORMAT_H
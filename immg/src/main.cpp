@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <emmintrin.h>
 
 #include <ft2build.h>
 #include FT_FREETYPE_H 
@@ -11,6 +12,28 @@
 #include <stb_image_write.h>
 
 #include "imm_math.h"
+#include "imm_memory.h"
+#include "imm_arena.h"
+#include "imm_hit.h"
+#include "imm_state.h"
+#include "imm_texture.h"
+#include "imm_thread.h"
+#include "imm_tiled_image.h"
+#include "imm_resample.h"
+#include "imm_thumbnail.h"
+#include "imm_regress.h"
+#include "imm_text_edit.h"
+#include "imm_backend_gl.h"
+#include "imm_vertex_format.h"
+
+// NOTE: glyphs are rasterized in worker threads, until the glyph is in the atlas
+// the entry is pending and only the estimated advance can be used
+enum imm_glyph_state_t
+{
+    glyph_state_pending,
+    glyph_state_ready,
+    glyph_state_missing,
+};
 
 struct imm_character_t
 {
@@ -19,66 +42,183 @@ struct imm_character_t
     v2 size;
     v2 baring;
     int advance;
+    imm_glyph_state_t state;
+};
+
+// NOTE: fonts and styles that can live in the shared character atlas
+// NOTE: a family without a face for some style resolves it with the regular face
+
+enum imm_font_type_t
+{
+    font_type_vera,
+    font_type_jetbrains_mono,
+
+    font_type_count,
+};
+
+enum imm_font_style_t
+{
+    font_style_regular,
+    font_style_bold,
+    font_style_italic,
+    font_style_bold_italic,
+
+    font_style_count,
+};
+
+struct imm_font_t
+{
+    const char *paths[font_style_count];
+    // NOTE: next font to try when a glyph is missing, -1 ends the chain
+    s32 fallback;
+};
+
+static imm_font_t imm_fonts[font_type_count];
+
+// NOTE: freetype faces can not be shared between threads, every rasterizer has its
+// own library and faces and a worker locks one of them for each glyph
+struct imm_glyph_rasterizer_t
+{
+    SDL_mutex *mutex;
+    FT_Library freetype;
+    FT_Face faces[font_type_count][font_style_count];
+    u32 pixel_size[font_type_count][font_style_count];
 };
 
+#define imm_glyph_rasterizer_count 2
+static imm_glyph_rasterizer_t imm_glyph_rasterizers[imm_glyph_rasterizer_count];
+
 // NOTE: simple hash table to save the text rendering metrics
 // NOTE: for simplicity is a static hash table and use internal probing
+// NOTE: the key packs font, style, size and codepoint so every style can share one table
 
 struct imm_character_hash_bucket_t
 {
     bool used;
-    char glyph;
+    u64 key;
     imm_character_t metric;
 };
 
-#define imm_character_hash_size 512
+#define imm_character_hash_size 4096
 struct imm_character_hash_t
 {
     imm_character_hash_bucket_t data[imm_character_hash_size];    
 };
 
-void imm_character_hash_add(imm_character_hash_t *hash, char glyph, imm_character_t metric)
+inline u64 imm_character_key(imm_font_type_t font, imm_font_style_t style, u32 size, u32 codepoint)
+{
+    u64 result = (u64)codepoint | ((u64)(size & 0xFFFF) << 32) | ((u64)style << 48) | ((u64)font << 56);
+    return result;
+}
+
+inline u32 imm_character_hash_index(u64 key)
+{
+    u32 result = (u32)((key * 0x9E3779B97F4A7C15ULL) >> 52) & (imm_character_hash_size - 1);
+    return result;
+}
+
+imm_character_t *imm_character_hash_add(imm_character_hash_t *hash, u64 key, imm_character_t metric)
 {
-    u32 index = glyph & (imm_character_hash_size - 1);
-    imm_character_hash_bucket_t *bucket = hash->data + index;
-    while(bucket->used)
+    u32 index = imm_character_hash_index(key);
+    for(u32 probe = 0; probe < imm_character_hash_size; ++probe)
     {
-        index++;
-        assert(index < imm_character_hash_size);
-        bucket = hash->data + index;
+        imm_character_hash_bucket_t *bucket = hash->data + index;
+        if(!bucket->used)
+        {
+            bucket->used = true;
+            bucket->key = key;
+            bucket->metric = metric;
+            return &bucket->metric;
+        }
+        index = (index + 1) & (imm_character_hash_size - 1);
     }
-    bucket->used = true;
-    bucket->glyph = glyph;
-    bucket->metric = metric;
+    printf("[character-hash-error]: hash table is full\n");
+    return 0;
 }
 
-imm_character_t *imm_character_hash_get(imm_character_hash_t *hash, char glyph)
+imm_character_t *imm_character_hash_get(imm_character_hash_t *hash, u64 key)
 {
-    u32 index = glyph & (imm_character_hash_size - 1);
-    imm_character_hash_bucket_t *bucket = hash->data + index;
-    if(bucket->used)
+    u32 index = imm_character_hash_index(key);
+    for(u32 probe = 0; probe < imm_character_hash_size; ++probe)
     {
-        while(bucket->glyph != glyph)
+        imm_character_hash_bucket_t *bucket = hash->data + index;
+        if(!bucket->used)
         {
-            index++;
-            assert(index < imm_character_hash_size);
-            bucket = hash->data + index;
+            break;
         }
-        return &bucket->metric;
+        if(bucket->key == key)
+        {
+            return &bucket->metric;
+        }
+        index = (index + 1) & (imm_character_hash_size - 1);
     }
     return 0;
 }
 
+struct imm_character_atlas_t;
+
+// NOTE: a glyph waiting to be rasterized or waiting to be packed in the atlas,
+// the bitmap is allocated by the worker and freed when it is copied to the atlas
+struct imm_glyph_request_t
+{
+    imm_character_atlas_t *atlas;
+    u64 key;
+    imm_font_type_t font;
+    imm_font_style_t style;
+    u32 size;
+    u32 codepoint;
+
+    u8 *bitmap;
+    u32 width;
+    u32 height;
+    s32 left;
+    s32 top;
+    s32 advance;
+    bool failed;
+};
+
+#define imm_glyph_max_requests 512
+#define imm_glyph_packs_per_frame 256
+
+// NOTE: one atlas shared by every font, style and size, glyphs are packed lazily
+// in shelves the first time they are used. Only the rows touched since the last
+// upload are sent to the GPU, so the whole gui can be drawn with one texture bind
 struct imm_character_atlas_t
 {
-    unsigned int texture_id;
+    u32 texture_id;
     imm_character_hash_t hash;
     char *buffer;
     u32 width;
     u32 height;
-    u32 font_size;
+    u32 padding;
+    
+    u32 shelf_x;
+    u32 shelf_y;
+    u32 shelf_height;
+
+    u32 dirty_min_y;
+    u32 dirty_max_y;
+    // NOTE: glyphs that did not fit, the error is printed for the first one only
+    u32 full_count;
+
+    imm_job_queue_t queue;
+    imm_glyph_request_t requests[imm_glyph_max_requests];
+    u32 free_requests[imm_glyph_max_requests];
+    u32 free_request_count;
+    
+    SDL_mutex *done_mutex;
+    u32 done[imm_glyph_max_requests];
+    u32 done_count;
+
+    // NOTE: returned for the glyphs that could not be queued this frame
+    imm_character_t estimate;
 };
 
+static imm_character_atlas_t character_atlas;
+
+// NOTE: shorthand for the two sizes of black regular vera used by the labels of the
+// gui, imm_render_push_text_rect takes it. Text with other fonts, styles, sizes or
+// colors is pushed as runs with imm_render_push_text_runs
 enum imm_character_atlas_type_t
 {
     character_atlas_type_small,
@@ -87,115 +227,367 @@ enum imm_character_atlas_type_t
     character_atlas_type_count,
 };
 
-static imm_character_atlas_t character_atlas[character_atlas_type_count];
+static u32 character_atlas_type_size[character_atlas_type_count] = { 16, 24 };
+
+void imm_font_load(imm_font_type_t font, imm_font_style_t style, const char *path)
+{
+    imm_fonts[font].paths[style] = path;
+}
 
-void imm_character_atlas_init(imm_character_atlas_t *atlas, const char *path, u32 width, u32 height, u32 font_size, u32 padding)
+void imm_glyph_rasterizer_init(imm_glyph_rasterizer_t *rasterizer)
 {
-    FT_Library ft;
-    if(FT_Init_FreeType(&ft))
+    rasterizer->mutex = SDL_CreateMutex();
+    if(FT_Init_FreeType(&rasterizer->freetype))
     {
         printf("[freetype-error]: could not init free type library\n");
+        return;
     }
-    FT_Face face; 
-    if(FT_New_Face(ft, path, 0, &face))
+    for(u32 font = 0; font < font_type_count; ++font)
     {
-        printf("[freetype-error]: fail to load font\n");
+        for(u32 style = 0; style < font_style_count; ++style)
+        {
+            const char *path = imm_fonts[font].paths[style];
+            if(path && FT_New_Face(rasterizer->freetype, path, 0, &rasterizer->faces[font][style]))
+            {
+                printf("[freetype-error]: fail to load font %s\n", path);
+                rasterizer->faces[font][style] = 0;
+            }
+        }
     }
+}
 
-    FT_Set_Pixel_Sizes(face, 0, font_size);
+FT_Face imm_glyph_rasterizer_get_face(imm_glyph_rasterizer_t *rasterizer, imm_font_type_t font, imm_font_style_t style, u32 size)
+{
+    FT_Face *faces = rasterizer->faces[font];
+    if(!faces[style])
+    {
+        // NOTE: bold italic falls back to bold before regular
+        style = (style == font_style_bold_italic && faces[font_style_bold]) ? font_style_bold : font_style_regular;
+    }
+    FT_Face face = faces[style];
+    if(face && rasterizer->pixel_size[font][style] != size)
+    {
+        FT_Set_Pixel_Sizes(face, 0, size);
+        rasterizer->pixel_size[font][style] = size;
+    }
+    return face;
+}
 
-    u32 atlas_height = height; 
-    u32 atlas_width = width;
+// NOTE: rasterize one glyph walking the fallback chain of the font, the result is
+// saved under the requested font key so the chain is only walk once
+void imm_glyph_rasterize(imm_glyph_rasterizer_t *rasterizer, imm_glyph_request_t *request)
+{
+    request->failed = true;
+    request->bitmap = 0;
 
-    char *atlas_buffer = (char *)malloc(atlas_width * atlas_height);
-    memset(atlas_buffer, 0, (atlas_width * atlas_height));
-    
-    u32 atlas_x_offset = padding;
-    u32 atlas_y_offset = padding;
+    FT_Face face = 0;
+    FT_UInt glyph_index = 0;
+    s32 chain = request->font;
+    for(u32 step = 0; (step < font_type_count) && (chain >= 0); ++step)
+    {
+        FT_Face candidate = imm_glyph_rasterizer_get_face(rasterizer, (imm_font_type_t)chain, request->style, request->size);
+        if(candidate)
+        {
+            glyph_index = FT_Get_Char_Index(candidate, request->codepoint);
+            if(glyph_index)
+            {
+                face = candidate;
+                break;
+            }
+        }
+        chain = imm_fonts[chain].fallback;
+    }
     
-    for(u8 c = ' '; c < 128; ++c)
+    if(!face)
     {
-        if(FT_Load_Char(face, c, FT_LOAD_RENDER))
+        // NOTE: no font in the chain has the glyph, use the missing glyph of the requested font
+        face = imm_glyph_rasterizer_get_face(rasterizer, request->font, request->style, request->size);
+        if(!face)
         {
-            printf("[freetype-error]: fail to load glyph %c\n", c);
-            continue;
+            return;
         }
+    }
 
-        u32 glyph_width = face->glyph->bitmap.width;
-        u32 glyph_height = face->glyph->bitmap.rows;
-        s32 glyph_pitch = face->glyph->bitmap.pitch;
-        
-        if((atlas_x_offset + glyph_width) >= atlas_width)
+    if(FT_Load_Glyph(face, glyph_index, FT_LOAD_RENDER))
+    {
+        printf("[freetype-error]: fail to load glyph %u\n", request->codepoint);
+        return;
+    }
+
+    FT_Bitmap *bitmap = &face->glyph->bitmap;
+    request->width = bitmap->width;
+    request->height = bitmap->rows;
+    request->left = face->glyph->bitmap_left;
+    request->top = face->glyph->bitmap_top;
+    request->advance = (s32)face->glyph->advance.x;
+    if(request->width && request->height)
+    {
+        request->bitmap = (u8 *)imm_alloc(request->width * request->height, memory_tag_atlas);
+        for(u32 y = 0; y < request->height; ++y)
         {
-            atlas_x_offset = padding;
-            atlas_y_offset += font_size + padding; 
+            memcpy(request->bitmap + y * request->width, bitmap->buffer + y * bitmap->pitch, request->width);
         }
+    }
+    request->failed = false;
+}
 
-        for(u32 y = 0; y < glyph_height; ++y)
+void imm_glyph_rasterize_job(void *data)
+{
+    imm_glyph_request_t *request = (imm_glyph_request_t *)data;
+    imm_character_atlas_t *atlas = request->atlas;
+    
+    // NOTE: there is one rasterizer per worker, they are only all busy when the main
+    // thread is helping the workers in imm_job_queue_wait. Then it waits for one
+    // instead of spinning
+    imm_glyph_rasterizer_t *rasterizer = 0;
+    for(u32 i = 0; i < imm_glyph_rasterizer_count; ++i)
+    {
+        if(SDL_TryLockMutex(imm_glyph_rasterizers[i].mutex) == 0)
         {
-            for(u32 x = 0; x < glyph_width; ++x)
-            {
-                u32 y_pos = y + atlas_y_offset;
-                u32 x_pos = x + atlas_x_offset;
-                // NOTE: Clipping the atlas to the width and height
-                // TODO: this can be optimize, now is really slow
-                if((y_pos < atlas_height) && (x_pos < atlas_width))
-                {
-                    atlas_buffer[(y_pos * atlas_width) + x_pos] = face->glyph->bitmap.buffer[y * glyph_pitch + x];
-                }
-            }
+            rasterizer = imm_glyph_rasterizers + i;
+            break;
         }
-        
-        f32 u_0 = ((f32)(atlas_x_offset) / (f32)atlas_width);
-        f32 v_0 = ((f32)(atlas_y_offset) / (f32)atlas_height);
-        f32 u_1 = ((f32)(atlas_x_offset + glyph_width) / (f32)atlas_width);
-        f32 v_1 = ((f32)(atlas_y_offset + glyph_height) / (f32)atlas_height);
+    }
+    if(!rasterizer)
+    {
+        rasterizer = imm_glyph_rasterizers + ((request - atlas->requests) % imm_glyph_rasterizer_count);
+        SDL_LockMutex(rasterizer->mutex);
+    }
+    imm_glyph_rasterize(rasterizer, request);
+    SDL_UnlockMutex(rasterizer->mutex);
+
+    SDL_LockMutex(atlas->done_mutex);
+    atlas->done[atlas->done_count++] = (u32)(request - atlas->requests);
+    SDL_UnlockMutex(atlas->done_mutex);
+}
 
-        atlas_x_offset += glyph_width + padding;
+bool imm_character_atlas_reserve(imm_character_atlas_t *atlas, u32 width, u32 height, u32 *x, u32 *y)
+{
+    if((atlas->shelf_x + width + atlas->padding) >= atlas->width)
+    {
+        atlas->shelf_x = atlas->padding;
+        atlas->shelf_y += atlas->shelf_height + atlas->padding;
+        atlas->shelf_height = 0;
+    }
+    if((atlas->shelf_y + height + atlas->padding) >= atlas->height)
+    {
+        return false;
+    }
+    *x = atlas->shelf_x;
+    *y = atlas->shelf_y;
+    atlas->shelf_x += width + atlas->padding;
+    atlas->shelf_height = u32_max_2(atlas->shelf_height, height);
+    atlas->dirty_min_y = u32_min_2(atlas->dirty_min_y, *y);
+    atlas->dirty_max_y = u32_max_2(atlas->dirty_max_y, *y + height);
+    return true;
+}
 
-        imm_character_t character =
+// NOTE: copy a rasterized glyph in the atlas and make its entry ready
+void imm_character_atlas_pack(imm_character_atlas_t *atlas, imm_glyph_request_t *request)
+{
+    imm_character_t *character = imm_character_hash_get(&atlas->hash, request->key);
+    if(!character)
+    {
+        return;
+    }
+    
+    u32 atlas_x_offset = 0;
+    u32 atlas_y_offset = 0;
+    if(request->failed)
+    {
+        character->state = glyph_state_missing;
+        return;
+    }
+    if(!imm_character_atlas_reserve(atlas, request->width, request->height, &atlas_x_offset, &atlas_y_offset))
+    {
+        if(atlas->full_count++ == 0)
         {
-            _v2(u_0, v_0), // NOTE: texture_coord_0
-            _v2(u_1, v_1), // NOTE: texture_coord_1
-            _v2((f32)glyph_width, (f32)glyph_height),
-            _v2((f32)face->glyph->bitmap_left, (f32)face->glyph->bitmap_top),
-            face->glyph->advance.x 
-        };
-        imm_character_hash_add(&atlas->hash, c, character);
-        atlas->width = atlas_width;
-        atlas->height = atlas_height;
-        atlas->buffer = atlas_buffer;
-        atlas->font_size = font_size;
+            printf("[character-atlas-error]: atlas of %ux%u is full, the new glyphs are not drawn\n", atlas->width, atlas->height);
+        }
+        character->state = glyph_state_missing;
+        return;
+    }
+    
+    for(u32 y = 0; y < request->height; ++y)
+    {
+        char *dst = atlas->buffer + ((atlas_y_offset + y) * atlas->width) + atlas_x_offset;
+        memcpy(dst, request->bitmap + y * request->width, request->width);
+    }
+    
+    f32 u_0 = ((f32)(atlas_x_offset) / (f32)atlas->width);
+    f32 v_0 = ((f32)(atlas_y_offset) / (f32)atlas->height);
+    f32 u_1 = ((f32)(atlas_x_offset + request->width) / (f32)atlas->width);
+    f32 v_1 = ((f32)(atlas_y_offset + request->height) / (f32)atlas->height);
+
+    character->min_uv = _v2(u_0, v_0); // NOTE: texture_coord_0
+    character->max_uv = _v2(u_1, v_1); // NOTE: texture_coord_1
+    character->size = _v2((f32)request->width, (f32)request->height);
+    character->baring = _v2((f32)request->left, (f32)request->top);
+    character->advance = request->advance;
+    character->state = glyph_state_ready;
+}
+
+// NOTE: never blocks, the first time a glyph is used it is queued for the workers
+// and a pending entry with an estimated advance is returned. When every request is
+// in the workers the glyph is not queued, it gets the estimate for this frame and
+// is asked again the next one
+imm_character_t *imm_character_atlas_get(imm_character_atlas_t *atlas, imm_font_type_t font, imm_font_style_t style, u32 size, u32 codepoint)
+{
+    u64 key = imm_character_key(font, style, size, codepoint);
+    imm_character_t *character = imm_character_hash_get(&atlas->hash, key);
+    if(character)
+    {
+        return character;
+    }
+    imm_character_t *estimate = &atlas->estimate;
+    memset(estimate, 0, sizeof(*estimate));
+    estimate->advance = (s32)(size / 2) << 6;
+    estimate->state = glyph_state_pending;
+    if(!atlas->free_request_count)
+    {
+        return estimate;
+    }
+
+    u32 request_index = atlas->free_requests[--atlas->free_request_count];
+    imm_glyph_request_t *request = atlas->requests + request_index;
+    request->key = key;
+    request->font = font;
+    request->style = style;
+    request->size = size;
+    request->codepoint = codepoint;
+
+    // NOTE: the entry is only added once the job is queued, so a full queue leaves the
+    // glyph out of the hash and it is asked again the next frame. The workers never
+    // touch the hash, the entry is always there before the glyph is packed
+    if(!imm_job_push(&atlas->queue, imm_glyph_rasterize_job, request))
+    {
+        atlas->free_requests[atlas->free_request_count++] = request_index;
+        return estimate;
+    }
+    character = imm_character_hash_add(&atlas->hash, key, *estimate);
+    return character ? character : estimate;
+}
+
+void imm_character_atlas_init(imm_character_atlas_t *atlas, u32 width, u32 height, u32 padding)
+{
+    atlas->width = width;
+    atlas->height = height;
+    atlas->padding = padding;
+    atlas->buffer = (char *)imm_alloc(width * height, memory_tag_atlas);
+    memset(atlas->buffer, 0, (width * height));
+    
+    atlas->shelf_x = padding;
+    atlas->shelf_y = padding;
+    atlas->shelf_height = 0;
+    atlas->dirty_min_y = height;
+    atlas->dirty_max_y = 0;
+    atlas->full_count = 0;
+
+    for(u32 i = 0; i < imm_glyph_max_requests; ++i)
+    {
+        atlas->requests[i].atlas = atlas;
+        atlas->free_requests[i] = i;
     }
+    atlas->free_request_count = imm_glyph_max_requests;
+    atlas->done_mutex = SDL_CreateMutex();
+    atlas->done_count = 0;
+    imm_job_queue_init(&atlas->queue, imm_glyph_rasterizer_count, "immg-glyphs");
 
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft);
+    atlas->texture_id = imm_backend->texture_create(width, height, texture_format_r8, atlas->buffer);
 }
 
-void imm_character_atlas_init_types()
+// NOTE: pack the glyphs finished by the workers and send all the rows with new
+// glyphs to the GPU in one upload, must be called before the draw call
+void imm_character_atlas_update(imm_character_atlas_t *atlas)
+{
+    u32 done[imm_glyph_packs_per_frame];
+    SDL_LockMutex(atlas->done_mutex);
+    u32 done_count = u32_min_2(atlas->done_count, imm_glyph_packs_per_frame);
+    memcpy(done, atlas->done, done_count * sizeof(u32));
+    memmove(atlas->done, atlas->done + done_count, (atlas->done_count - done_count) * sizeof(u32));
+    atlas->done_count -= done_count;
+    SDL_UnlockMutex(atlas->done_mutex);
+
+    for(u32 i = 0; i < done_count; ++i)
+    {
+        imm_glyph_request_t *request = atlas->requests + done[i];
+        imm_character_atlas_pack(atlas, request);
+        imm_free(request->bitmap);
+        request->bitmap = 0;
+        atlas->free_requests[atlas->free_request_count++] = done[i];
+    }
+
+    if(atlas->dirty_min_y < atlas->dirty_max_y)
+    {
+        u32 rows = atlas->dirty_max_y - atlas->dirty_min_y;
+        imm_backend->texture_update(atlas->texture_id, 0, atlas->dirty_min_y, atlas->width, rows, texture_format_r8,
+                                    atlas->buffer + (atlas->dirty_min_y * atlas->width), atlas->width);
+        atlas->dirty_min_y = atlas->height;
+        atlas->dirty_max_y = 0;
+    }
+}
+
+// NOTE: wait for every queued glyph, only for loading time or tools, never in a frame
+void imm_character_atlas_flush(imm_character_atlas_t *atlas)
 {
-    imm_character_atlas_init(&character_atlas[character_atlas_type_small], "data/bitstream_vera_sans/Vera.ttf", 256, 256, 16, 4);
-    imm_character_atlas_init(&character_atlas[character_atlas_type_large], "data/bitstream_vera_sans/Vera.ttf", 256, 256, 24, 4);
+    imm_job_queue_wait(&atlas->queue);
+    while(atlas->done_count)
+    {
+        imm_character_atlas_update(atlas);
+    }
+    imm_character_atlas_update(atlas);
+}
 
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // disable byte-alignment restriction
+void imm_character_atlas_shutdown(imm_character_atlas_t *atlas)
+{
+    imm_job_queue_shutdown(&atlas->queue);
+    SDL_DestroyMutex(atlas->done_mutex);
+    for(u32 i = 0; i < imm_glyph_max_requests; ++i)
+    {
+        imm_free(atlas->requests[i].bitmap);
+        atlas->requests[i].bitmap = 0;
+    }
+    imm_backend->texture_destroy(atlas->texture_id);
+    imm_free(atlas->buffer);
+    atlas->buffer = 0;
+    for(u32 i = 0; i < imm_glyph_rasterizer_count; ++i)
+    {
+        imm_glyph_rasterizer_t *rasterizer = imm_glyph_rasterizers + i;
+        FT_Done_FreeType(rasterizer->freetype);
+        SDL_DestroyMutex(rasterizer->mutex);
+    }
+}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+void imm_character_atlas_init_types()
+{
+    imm_font_load(font_type_vera, font_style_regular, "data/bitstream_vera_sans/Vera.ttf");
+    imm_font_load(font_type_vera, font_style_bold, "data/bitstream_vera_sans/VeraBd.ttf");
+    imm_font_load(font_type_vera, font_style_italic, "data/bitstream_vera_sans/VeraIt.ttf");
+    imm_font_load(font_type_vera, font_style_bold_italic, "data/bitstream_vera_sans/VeraBI.ttf");
+    imm_font_load(font_type_jetbrains_mono, font_style_regular, "data/JetBrainsMono-SemiBold.ttf");
+    
+    imm_fonts[font_type_vera].fallback = font_type_jetbrains_mono;
+    imm_fonts[font_type_jetbrains_mono].fallback = -1;
 
-    glCreateTextures(GL_TEXTURE_2D, 1, &character_atlas[character_atlas_type_small].texture_id);
-    glBindTexture(GL_TEXTURE_2D, character_atlas[character_atlas_type_small].texture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, character_atlas[character_atlas_type_small].width, character_atlas[character_atlas_type_small].height, 0, GL_RED, GL_UNSIGNED_BYTE, character_atlas[character_atlas_type_small].buffer);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    for(u32 i = 0; i < imm_glyph_rasterizer_count; ++i)
+    {
+        imm_glyph_rasterizer_init(imm_glyph_rasterizers + i);
+    }
 
-    glCreateTextures(GL_TEXTURE_2D, 1, &character_atlas[character_atlas_type_large].texture_id);
-    glBindTexture(GL_TEXTURE_2D, character_atlas[character_atlas_type_large].texture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, character_atlas[character_atlas_type_large].width, character_atlas[character_atlas_type_large].height, 0, GL_RED, GL_UNSIGNED_BYTE, character_atlas[character_atlas_type_large].buffer);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    // NOTE: glyphs are never evicted, the atlas fits about 2500 glyphs of 24 pixels or
+    // 5000 of 16 for every font, style and size together. The glyphs after that are
+    // missing for the rest of the run
+    imm_character_atlas_init(&character_atlas, 1024, 1024, 4);
     
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);  
+    // NOTE: warm the atlas with the ascii range of the label sizes
+    for(u32 type = 0; type < character_atlas_type_count; ++type)
+    {
+        for(u32 c = ' '; c < 128; ++c)
+        {
+            imm_character_atlas_get(&character_atlas, font_type_vera, font_style_regular, character_atlas_type_size[type], c);
+        }
+    }
+    imm_character_atlas_flush(&character_atlas);
 }
 
 void imm_character_atlas_write_to_disk(imm_character_atlas_t *atlas, const char *path)
@@ -206,247 +598,1301 @@ void imm_character_atlas_write_to_disk(imm_character_atlas_t *atlas, const char
     }
 }
 
-void *imm_read_entire_file(const char *path, u64 *file_size)
+// NOTE: every primitive is one quad. Solid quads, glyphs and images have their own
+// pipeline with the smallest vertex they need, the signed distance shapes and the
+// line paths share the sdf pipeline where the fragment shader use the kind to know
+// the shape to evaluate, so only those have a kind. local is the position relative
+// to the center of the shape in pixels
+enum imm_primitive_kind_t
 {
-    FILE *file = fopen(path, "rb"); 
-    fseek(file, 0, SEEK_END);
-    *file_size = (u64)ftell(file);
-    fseek(file, 0, SEEK_SET);
-    void *buffer = malloc(*file_size + 1);
-    fread(buffer, (size_t)*file_size, 1, file);
-    ((char *)buffer)[*file_size] = 0;
-    fclose(file);
-    return buffer;
-}
+    primitive_kind_rounded_rect,
+    primitive_kind_circle,
+    primitive_kind_shadow,
+    primitive_kind_line,
+};
 
-struct imm_texture_t
+enum imm_pipeline_t
 {
-    void *pixels;
-    u32 width, height;
-    s32 pitch;
+    pipeline_sdf,
+    pipeline_solid,
+    pipeline_glyph,
+    pipeline_image,
+
+    pipeline_count,
 };
 
-imm_texture_t imm_texture_load_bmp(const char *path)
+struct imm_vertex_t
 {
-    u64 file_size;
-    void *file = imm_read_entire_file(path, &file_size);
-    
-    u8 *header = (u8 *)file;
-    u32 pixel_offset = *(u32 *)(header + 10);
-    u8 *info_header = header + 14;
-    u32 width = *(u32 *)(info_header + 4);
-    u32 height = *(u32 *)(info_header + 8);
-    u16 bpp = *(u16 *)(info_header + 14);
-    
-    u64 texture_size = width * height * (bpp / 8);
-    imm_texture_t texture = {};
-    texture.pixels = malloc(texture_size);
-    memcpy(texture.pixels, (void *)(header + pixel_offset), texture_size);
-    texture.width = width;
-    texture.height = height;
-    texture.pitch = width * (bpp / 8);
+    v2 position;
+    v4 color;
+    v2 local;
+    v2 half_size;
+    // NOTE: radius, border, softness and primitive kind
+    v4 shape;
+    f32 depth;
+};
+
+struct imm_vertex_solid_t
+{
+    v2 position;
+    v4 color;
+    f32 depth;
+};
+
+struct imm_vertex_glyph_t
+{
+    v2 position;
+    v2 uvs;
+    v3 color;
+    f32 depth;
+};
 
-    free(file);
+// NOTE: images are never tinted
+struct imm_vertex_image_t
+{
+    v2 position;
+    v2 uvs;
+    f32 depth;
+};
+
+imm_vertex_format(imm_vertex_t, pipeline_sdf, KB(64),
+                  imm_vertex_attribute(imm_vertex_t, position),
+                  imm_vertex_attribute(imm_vertex_t, color),
+                  imm_vertex_attribute(imm_vertex_t, local),
+                  imm_vertex_attribute(imm_vertex_t, half_size),
+                  imm_vertex_attribute(imm_vertex_t, shape),
+                  imm_vertex_attribute(imm_vertex_t, depth))
+
+imm_vertex_format(imm_vertex_solid_t, pipeline_solid, KB(32),
+                  imm_vertex_attribute(imm_vertex_solid_t, position),
+                  imm_vertex_attribute(imm_vertex_solid_t, color),
+                  imm_vertex_attribute(imm_vertex_solid_t, depth))
+
+imm_vertex_format(imm_vertex_glyph_t, pipeline_glyph, KB(32),
+                  imm_vertex_attribute(imm_vertex_glyph_t, position),
+                  imm_vertex_attribute(imm_vertex_glyph_t, uvs),
+                  imm_vertex_attribute(imm_vertex_glyph_t, color),
+                  imm_vertex_attribute(imm_vertex_glyph_t, depth))
+
+imm_vertex_format(imm_vertex_image_t, pipeline_image, KB(4),
+                  imm_vertex_attribute(imm_vertex_image_t, position),
+                  imm_vertex_attribute(imm_vertex_image_t, uvs),
+                  imm_vertex_attribute(imm_vertex_image_t, depth))
+
+// TODO: make gui struct to handle all state in one place
+// NOTE: internal gui state
+
+static u32 imm_index_buffer[KB(96)];
+static u32 imm_index_buffer_size = KB(96);
+static u32 imm_index_buffer_count = 0;
 
-    return texture;
+// NOTE: a new command starts every time the pipeline changes, so the blended
+// primitives keep the order they were pushed in. Every command has at least one
+// triangle, so the commands never run out before the indices
+static imm_draw_command_t imm_draw_commands[KB(96) / 3];
+static u32 imm_draw_command_count = 0;
+
+// NOTE: with the opaque pass the solid quads without transparency are drawn first,
+// front to back with the depth test and no blending, so every pixel covered by an
+// opaque quad is shaded once. Every primitive gets a depth from its push order and
+// the translucent pass keeps the back to front order but is also depth tested.
+// The opaque indices grow down from the end of the index buffer, so reading them
+// forward already gives the front to back order
+static bool imm_opaque_pass = true;
+static u32 imm_opaque_index_buffer_count = 0;
+static u32 imm_depth_count = 0;
+#define imm_depth_steps (1 << 20)
+#define imm_opaque_pipeline pipeline_solid
+
+inline f32 imm_render_next_depth()
+{
+    imm_depth_count = u32_min_2(imm_depth_count + 1, imm_depth_steps - 1);
+    return 1.0f - ((f32)imm_depth_count / (f32)imm_depth_steps);
 }
 
-void imm_texture_free(imm_texture_t *texture)
+// NOTE: to compare the samples the GPU shade with the area the gui pushed
+struct imm_overdraw_stats_t
+{
+    f64 quad_area;
+    u32 opaque_quads;
+    // NOTE: primitives that did not fit in the buffers of the frame
+    u32 dropped;
+
+    f64 last_quad_area;
+    u32 last_opaque_quads;
+    u32 last_dropped;
+};
+
+static imm_overdraw_stats_t imm_overdraw;
+
+static u32 imm_quad_indices[6] = { 0, 1, 3, 1, 2, 3 };
+
+// NOTE: reserve the vertices of one primitive of any format and write its indices,
+// relative to the first vertex. Only the opaque pipeline can go to the opaque pass.
+// A texture other than 0 replaces the image texture of the list for the primitive.
+// Return 0 when the frame is full, the rest of the frame is dropped because the
+// buffers are only clear at the end of the frame
+template <typename vertex_t>
+vertex_t *imm_render_push_vertices(u32 vertex_count, u32 *indices, u32 index_count, bool opaque, u32 texture = 0)
 {
-    if(texture)
+    u32 pipeline = imm_vertex_format_t<vertex_t>::pipeline;
+    imm_vertex_stream_t *stream = imm_vertex_stream<vertex_t>();
+    if((stream->count + vertex_count) > stream->capacity || (imm_index_buffer_count + imm_opaque_index_buffer_count + index_count) > imm_index_buffer_size)
     {
-        free(texture->pixels);
-        texture->pixels = 0;
+        imm_overdraw.dropped++;
+        return 0;
     }
-}
 
-unsigned int imm_load_gl_shader(const char *vertex, const char *fragment)
-{
-    u64 vertex_size, fragment_size;
-    void *vertex_file = imm_read_entire_file(vertex, &vertex_size);
-    void *fragment_file = imm_read_entire_file(fragment, &fragment_size);
-    
-    int vertex_compile, fragment_compile, program_link; 
-    
-    unsigned int vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &(char *)vertex_file, 0);
-    glCompileShader(vertex_shader);
-    
-    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &vertex_compile);
-    if(vertex_compile != GL_TRUE)
+    u32 *dst = 0;
+    if(opaque && (pipeline == imm_opaque_pipeline))
+    {
+        imm_opaque_index_buffer_count += index_count;
+        dst = imm_index_buffer + (imm_index_buffer_size - imm_opaque_index_buffer_count);
+    }
+    else
+    {
+        imm_draw_command_t *command = imm_draw_command_count ? imm_draw_commands + (imm_draw_command_count - 1) : 0;
+        if(!command || (command->pipeline != pipeline) || (command->texture != texture))
+        {
+            if(imm_draw_command_count == array_count(imm_draw_commands))
+            {
+                imm_overdraw.dropped++;
+                return 0;
+            }
+            command = imm_draw_commands + imm_draw_command_count++;
+            command->pipeline = pipeline;
+            command->texture = texture;
+            command->index_offset = imm_index_buffer_count;
+            command->index_count = 0;
+        }
+        command->index_count += index_count;
+        dst = imm_index_buffer + imm_index_buffer_count;
+        imm_index_buffer_count += index_count;
+    }
+    for(u32 i = 0; i < index_count; ++i)
     {
-        u64 log_length = 0;
-        char message[1024];
-        glGetShaderInfoLog(vertex_shader, 1024, (GLsizei *)&log_length, message);
-        printf("[vertex-shader-error]:\n%s\n", message);
+        dst[i] = stream->count + indices[i];
     }
 
-    unsigned int fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &(char *)fragment_file, 0);
-    glCompileShader(fragment_shader);
+    vertex_t *result = (vertex_t *)stream->vertices + stream->count;
+    stream->count += vertex_count;
+    return result;
+}
 
-    glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &fragment_compile);
-    if(fragment_compile != GL_TRUE)
+template <typename vertex_t>
+bool imm_render_push_quad_vertices(vertex_t *quad, bool opaque, u32 texture = 0)
+{
+    vertex_t *dst = imm_render_push_vertices<vertex_t>(4, imm_quad_indices, 6, opaque, texture);
+    if(!dst)
     {
-        u64 log_length = 0;
-        char message[1024];
-        glGetShaderInfoLog(fragment_shader, 1024, (GLsizei *)&log_length, message);
-        printf("[fragment-shader-error]:\n%s\n", message);
+        return false;
     }
+    memcpy(dst, quad, 4 * sizeof(vertex_t));
+    return true;
+}
 
-    unsigned int program = glCreateProgram();
-    glAttachShader(program, vertex_shader);
-    glAttachShader(program, fragment_shader);
-    glLinkProgram(program);
-     
-    glGetProgramiv(program, GL_LINK_STATUS, &program_link);
-    if(program_link != GL_TRUE)
+// NOTE: push arbitrary triangles, the indices are relative to the first vertex
+template <typename vertex_t>
+void imm_render_push_triangles(vertex_t *vertices, u32 vertex_count, u32 *indices, u32 index_count)
+{
+    vertex_t *dst = imm_render_push_vertices<vertex_t>(vertex_count, indices, index_count, false);
+    if(!dst)
     {
-        u64 log_length = 0;
-        char message[1024];
-        glGetProgramInfoLog(program, 1024, (GLsizei *)&log_length, message);
-        printf("[program-link-error]:\n%s\n", message);
+        return;
     }
-    
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
 
-    free(vertex_file);
-    free(fragment_file);
-
-    return program;
+    // NOTE: paths are always translucent, the whole call share one depth
+    f32 z = imm_render_next_depth();
+    memcpy(dst, vertices, vertex_count * sizeof(vertex_t));
+    for(u32 i = 0; i < vertex_count; ++i)
+    {
+        dst[i].depth = z;
+    }
 }
 
-// TODO: vertex should have texture coordinates, propably the gui should be able to render
-// texture and not texture rects for memory optimisations
-struct imm_vertex_t
+// NOTE: the list of everything pushed this frame, the same list can be drawn by every window
+imm_render_list_t imm_render_list_build(s32 width, s32 height, v4 clear_color, u32 atlas_texture, u32 image_texture)
 {
-    float x, y;
-    float u, v;
-    float r, g, b;
-};
+    imm_render_list_t list = {};
+    list.width = width;
+    list.height = height;
+    for(u32 pipeline = 0; pipeline < pipeline_count; ++pipeline)
+    {
+        list.streams[pipeline].vertices = imm_vertex_streams[pipeline].vertices;
+        list.streams[pipeline].count = imm_vertex_streams[pipeline].count;
+    }
+    list.opaque_indices = imm_index_buffer + (imm_index_buffer_size - imm_opaque_index_buffer_count);
+    list.opaque_index_count = imm_opaque_index_buffer_count;
+    list.opaque_pipeline = imm_opaque_pipeline;
+    list.indices = imm_index_buffer;
+    list.index_count = imm_index_buffer_count;
+    list.commands = imm_draw_commands;
+    list.command_count = imm_draw_command_count;
+    list.clear_color = clear_color;
+    list.textures[0] = atlas_texture;
+    list.textures[1] = image_texture;
+    return list;
+}
 
-// TODO: make gui struct to handle all state in one place
-// NOTE: internal gui state
+// NOTE: clear gui buffers
+void imm_render_reset()
+{
+    imm_vertex_streams_reset();
+    imm_index_buffer_count = 0;
+    imm_opaque_index_buffer_count = 0;
+    imm_draw_command_count = 0;
+    imm_depth_count = 0;
+}
 
-#define imm_index_offset(a) (imm_index_offset + (a))
+void imm_render_push_solid_quad(v2 pos, v2 dim, v4 color)
+{
+    v2 max = pos + dim;
+    f32 z = imm_render_next_depth();
+    imm_vertex_solid_t quad[4] =
+    {
+        {{pos.x, pos.y}, color, z},
+        {{pos.x, max.y}, color, z},
+        {{max.x, max.y}, color, z},
+        {{max.x, pos.y}, color, z},
+    };
+    bool opaque = imm_opaque_pass && (color.w >= 1.0f);
+    if(imm_render_push_quad_vertices(quad, opaque))
+    {
+        imm_overdraw.opaque_quads += opaque ? 1 : 0;
+        imm_overdraw.quad_area += (f64)dim.x * (f64)dim.y;
+    }
+}
 
-static imm_vertex_t imm_vertex_buffer[1024];
-static u32 imm_vertex_buffer_size = 1024;
-static u32 imm_vertex_buffer_count = 0;
+void imm_render_push_glyph_quad(v2 pos, v2 dim, v3 color, v2 min_uv, v2 max_uv)
+{
+    v2 max = pos + dim;
+    f32 z = imm_render_next_depth();
+    imm_vertex_glyph_t quad[4] =
+    {
+        {{pos.x, pos.y}, {min_uv.x, min_uv.y}, color, z},
+        {{pos.x, max.y}, {min_uv.x, max_uv.y}, color, z},
+        {{max.x, max.y}, {max_uv.x, max_uv.y}, color, z},
+        {{max.x, pos.y}, {max_uv.x, min_uv.y}, color, z},
+    };
+    if(imm_render_push_quad_vertices(quad, false))
+    {
+        imm_overdraw.quad_area += (f64)dim.x * (f64)dim.y;
+    }
+}
 
-static u32 imm_index_buffer[1024];
-static u32 imm_index_buffer_size = 1024;
-static u32 imm_index_buffer_count = 0;
-static u32 imm_index_offset = 0;
+void imm_render_push_image_quad(v2 pos, v2 dim, v2 min_uv, v2 max_uv, u32 texture)
+{
+    v2 max = pos + dim;
+    f32 z = imm_render_next_depth();
+    imm_vertex_image_t quad[4] =
+    {
+        {{pos.x, pos.y}, {min_uv.x, min_uv.y}, z},
+        {{pos.x, max.y}, {min_uv.x, max_uv.y}, z},
+        {{max.x, max.y}, {max_uv.x, max_uv.y}, z},
+        {{max.x, pos.y}, {max_uv.x, min_uv.y}, z},
+    };
+    if(imm_render_push_quad_vertices(quad, false, texture))
+    {
+        imm_overdraw.quad_area += (f64)dim.x * (f64)dim.y;
+    }
+}
 
-void imm_render_push_rect_raw(v2 pos, v2 dim, v3 color, v2 min_uv, v2 max_uv)
+void imm_render_push_quad(v2 pos, v2 dim, v4 color, imm_primitive_kind_t kind, f32 radius, f32 border, f32 softness)
 {
     f32 min_x = pos.x;
     f32 min_y = pos.y;
     f32 max_x = (pos.x + dim.x);
     f32 max_y = (pos.y + dim.y);
+    f32 hw = dim.x * 0.5f;
+    f32 hh = dim.y * 0.5f;
+    v4 shape = _v4(radius, border, softness, (f32)kind);
+    f32 z = imm_render_next_depth();
     
-    imm_vertex_t r[4];
-    r[0] = {min_x, min_y, min_uv.x, min_uv.y, color.x, color.y, color.z};
-    r[1] = {min_x, max_y, min_uv.x, max_uv.y, color.x, color.y, color.z};
-    r[2] = {max_x, max_y, max_uv.x, max_uv.y, color.x, color.y, color.z};
-    r[3] = {max_x, min_y, max_uv.x, min_uv.y, color.x, color.y, color.z};
-    memcpy(imm_vertex_buffer + imm_vertex_buffer_count, r, sizeof(r));
-    imm_vertex_buffer_count += 4;
-    
-    u32 i[6] = 
-    { 
-        imm_index_offset(0), imm_index_offset(1), imm_index_offset(3),
-        imm_index_offset(1), imm_index_offset(2), imm_index_offset(3)
+    imm_vertex_t r[4] =
+    {
+        {{min_x, min_y}, color, {-hw, -hh}, {hw, hh}, shape, z},
+        {{min_x, max_y}, color, {-hw,  hh}, {hw, hh}, shape, z},
+        {{max_x, max_y}, color, { hw,  hh}, {hw, hh}, shape, z},
+        {{max_x, min_y}, color, { hw, -hh}, {hw, hh}, shape, z},
     };
-    memcpy(imm_index_buffer + imm_index_buffer_count, i, sizeof(i));
-    imm_index_buffer_count += 6;
-    imm_index_offset += 4;
+    if(imm_render_push_quad_vertices(r, false))
+    {
+        imm_overdraw.quad_area += (f64)dim.x * (f64)dim.y;
+    }
 }
 
-void imm_render_push_text_rect(s32 x, s32 y, char *text, imm_character_atlas_type_t type)
+void imm_render_push_rect_raw(v2 pos, v2 dim, v3 color, v2 min_uv, v2 max_uv)
 {
-    glBindTexture(GL_TEXTURE_2D, character_atlas[type].texture_id);
-
-    u32 base = character_atlas[type].font_size;
-    for(char *c = text; *c != '\0'; ++c)
-    {
-        imm_character_t *character = imm_character_hash_get(&character_atlas[type].hash, *c);
-        
-        v2 position = {};
-        position.x = x + character->baring.x;
-        position.y = y + (base - character->baring.y);
+    imm_render_push_glyph_quad(pos, dim, color, min_uv, max_uv);
+}
 
-        imm_render_push_rect_raw(position, character->size, _v3(0, 0, 0), character->min_uv, character->max_uv);
+// NOTE: a run is a piece of text that share font, style, size and color
+// NOTE: if length is 0 the text must be null terminated
+struct imm_text_run_t
+{
+    char *text;
+    u32 length;
+    imm_font_type_t font;
+    imm_font_style_t style;
+    u32 size;
+    v3 color;
+};
 
-        x += (u32)((character->advance >> 6));
-    }
+inline imm_text_run_t imm_text_run(char *text, imm_font_type_t font, imm_font_style_t style, u32 size, v3 color)
+{
+    imm_text_run_t result = {text, 0, font, style, size, color};
+    return result;
 }
 
-void imm_render_push_rect(s32 x, s32 y, s32 width, s32 height, f32 red, f32 green, f32 blue)
+inline imm_text_run_t imm_text_run(imm_str_t text, imm_font_type_t font, imm_font_style_t style, u32 size, v3 color)
 {
-    imm_render_push_rect_raw(_v2((f32)x, (f32)y), _v2((f32)width, (f32)height), _v3((f32)red, (f32)green, (f32)blue), _v2(0, 0), _v2(0, 0));
+    // NOTE: a empty string must not fall in the null terminated path
+    imm_text_run_t result = {text.length ? text.data : (char *)"", text.length, font, style, size, color};
+    return result;
 }
 
-int main(int argc, char **argv)
+// NOTE: push a paragraph of runs, all the runs share the baseline of the biggest size
+// and '\n' starts a new line. Every glyph come from the shared atlas so the whole 
+// paragraph ends in the same draw call
+void imm_render_push_text_runs(s32 x, s32 y, imm_text_run_t *runs, u32 run_count)
 {
-    SDL_Init(SDL_INIT_EVERYTHING);
-
-    int window_width = 1024;
-    int window_height = 512;
-    SDL_Window *window = SDL_CreateWindow("immg", 
-                                          SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 
-                                          window_width, window_height, SDL_WINDOW_OPENGL);
-
-    int error = 0;
-    error += SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
-    error += SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 5);
-    if(error)
+    u32 max_size = 0;
+    for(u32 i = 0; i < run_count; ++i)
     {
-        printf("[gl-error]: %s\n", SDL_GetError());
+        max_size = u32_max_2(max_size, runs[i].size);
     }
+    u32 line_height = max_size + (max_size / 4);
 
-    SDL_GLContext gl_ctx = SDL_GL_CreateContext(window);
-    
-    if(!gladLoadGL())
+    f32 pen_x = (f32)x;
+    f32 baseline = (f32)(y + max_size);
+    for(u32 i = 0; i < run_count; ++i)
     {
-        printf("[gl-error]: error initiallising GLAD\n");
-    }
-
-    unsigned int vao, vbo, ibo;
+        imm_text_run_t *run = runs + i;
+        u32 length = run->length ? run->length : (u32)strlen(run->text);
+        
+        u32 consumed = 0;
+        for(u32 offset = 0; offset < length; offset += consumed)
+        {
+            u32 codepoint = imm_utf8_decode(run->text + offset, length - offset, &consumed);
+            if(codepoint == '\n')
+            {
+                pen_x = (f32)x;
+                baseline += line_height;
+                continue;
+            }
+
+            imm_character_t *character = imm_character_atlas_get(&character_atlas, run->font, run->style, run->size, codepoint);
+            if(!character)
+            {
+                continue;
+            }
+            
+            if(character->state == glyph_state_ready)
+            {
+                v2 position = {};
+                position.x = pen_x + character->baring.x;
+                position.y = baseline - character->baring.y;
+                
+                imm_render_push_rect_raw(position, character->size, run->color, character->min_uv, character->max_uv);
+            }
+            else if(character->state == glyph_state_pending && codepoint != ' ')
+            {
+                // NOTE: placeholder box until the worker finish the glyph
+                f32 width = (f32)(character->advance >> 6) * 0.7f;
+                f32 height = (f32)run->size * 0.6f;
+                v4 color = _v4(run->color.x, run->color.y, run->color.z, 0.25f);
+                imm_render_push_solid_quad(_v2(pen_x + 1, baseline - height), _v2(width, height), color);
+            }
+
+            pen_x += (f32)(character->advance >> 6);
+        }
+    }
+}
+
+void imm_render_push_text_rect(s32 x, s32 y, char *text, imm_character_atlas_type_t type)
+{
+    imm_text_run_t run = imm_text_run(text, font_type_vera, font_style_regular, character_atlas_type_size[type], _v3(0, 0, 0));
+    imm_render_push_text_runs(x, y, &run, 1);
+}
+
+void imm_render_push_text_rect(s32 x, s32 y, imm_str_t text, imm_character_atlas_type_t type)
+{
+    imm_text_run_t run = imm_text_run(text, font_type_vera, font_style_regular, character_atlas_type_size[type], _v3(0, 0, 0));
+    imm_render_push_text_runs(x, y, &run, 1);
+}
+
+void imm_render_push_rect(s32 x, s32 y, s32 width, s32 height, f32 red, f32 green, f32 blue)
+{
+    imm_render_push_solid_quad(_v2((f32)x, (f32)y), _v2((f32)width, (f32)height), _v4(red, green, blue, 1.0f));
+}
+
+void imm_render_push_rounded_rect(s32 x, s32 y, s32 width, s32 height, f32 radius, v4 color)
+{
+    imm_render_push_quad(_v2((f32)x, (f32)y), _v2((f32)width, (f32)height), color, primitive_kind_rounded_rect, radius, 0, 0);
+}
+
+// NOTE: only the outline of the rect, the thickness grows to the inside of the rect
+void imm_render_push_rect_border(s32 x, s32 y, s32 width, s32 height, f32 radius, f32 thickness, v4 color)
+{
+    imm_render_push_quad(_v2((f32)x, (f32)y), _v2((f32)width, (f32)height), color, primitive_kind_rounded_rect, radius, thickness, 0);
+}
+
+void imm_overdraw_end_frame(imm_overdraw_stats_t *stats)
+{
+    stats->last_quad_area = stats->quad_area;
+    stats->last_opaque_quads = stats->opaque_quads;
+    stats->last_dropped = stats->dropped;
+    stats->quad_area = 0;
+    stats->opaque_quads = 0;
+    stats->dropped = 0;
+}
+
+// NOTE: the samples come from the backend one frame late, the quads of the same frame
+void imm_overdraw_stats_print(imm_overdraw_stats_t *stats, imm_window_t *window)
+{
+    f64 pixels = (f64)window->width * (f64)window->height;
+    printf("[overdraw]: opaque pass %s, %llu samples shaded (%.2fx the window), %.0f pixels pushed (%.2fx), %u opaque quads, %u primitives dropped\n",
+           imm_opaque_pass ? "on" : "off", (unsigned long long)window->samples, (f64)window->samples / pixels,
+           stats->last_quad_area, stats->last_quad_area / pixels, stats->last_opaque_quads, stats->last_dropped);
+}
+
+// NOTE: the quad is grown by the softness so the blur fits inside it. The softness is
+// at least half a pixel, the smoothstep of the shader is undefined when its edges are
+// equal and half a pixel is the anti-aliasing of the other shapes
+void imm_render_push_shadow(s32 x, s32 y, s32 width, s32 height, f32 radius, f32 softness, v4 color)
+{
+    softness = f32_max_2(softness, 0.5f);
+    v2 pos = _v2((f32)x - softness, (f32)y - softness);
+    v2 dim = _v2((f32)width + softness * 2.0f, (f32)height + softness * 2.0f);
+    imm_render_push_quad(pos, dim, color, primitive_kind_shadow, radius, 0, softness);
+}
+
+void imm_render_push_circle(s32 x, s32 y, f32 radius, v4 color)
+{
+    v2 pos = _v2((f32)x - radius, (f32)y - radius);
+    imm_render_push_quad(pos, _v2(radius * 2.0f, radius * 2.0f), color, primitive_kind_circle, radius, 0, 0);
+}
+
+void imm_render_push_circle_border(s32 x, s32 y, f32 radius, f32 thickness, v4 color)
+{
+    v2 pos = _v2((f32)x - radius, (f32)y - radius);
+    imm_render_push_quad(pos, _v2(radius * 2.0f, radius * 2.0f), color, primitive_kind_circle, radius, thickness, 0);
+}
+
+struct imm_text_edit_font_t
+{
+    imm_font_type_t font;
+    imm_font_style_t style;
+    u32 size;
+};
+
+// NOTE: the text edit measures with the atlas, a glyph still in the workers gives
+// a estimated advance and the line is measured again the next frame
+bool imm_text_edit_measure_atlas(void *user, u32 codepoint, f32 *advance)
+{
+    imm_text_edit_font_t *font = (imm_text_edit_font_t *)user;
+    imm_character_t *character = imm_character_atlas_get(&character_atlas, font->font, font->style, font->size, codepoint);
+    if(!character)
+    {
+        *advance = 0;
+        return true;
+    }
+    *advance = (f32)(character->advance >> 6);
+    return character->state != glyph_state_pending;
+}
+
+inline u32 imm_text_edit_line_height(imm_text_edit_font_t *font)
+{
+    return font->size + (font->size / 4);
+}
+
+// NOTE: byte position under a point of the rect of the editor
+u32 imm_text_edit_hit(imm_text_edit_t *edit, imm_text_edit_font_t *font, rect2d rect, v2 point)
+{
+    f32 line_height = (f32)imm_text_edit_line_height(font);
+    f32 y = f32_max_2(point.y - rect.min.y - 4, 0);
+    u32 line = u32_min_2(edit->scroll_line + (u32)(y / line_height), edit->line_count - 1);
+    return imm_text_edit_position_at_x(edit, line, point.x - rect.min.x - 4);
+}
+
+// NOTE: only the visible lines are copied and pushed, every line is a length delimited
+// run cut at the width of the rect with the cached layout
+void imm_render_push_text_edit(imm_text_edit_t *edit, imm_text_edit_font_t *font, rect2d rect, bool focused, imm_arena_t *arena)
+{
+    v2 dim = rect.max - rect.min;
+    imm_render_push_rect((s32)rect.min.x, (s32)rect.min.y, (s32)dim.x, (s32)dim.y, 0.12f, 0.12f, 0.14f);
+    if(focused)
+    {
+        imm_render_push_rect_border((s32)rect.min.x, (s32)rect.min.y, (s32)dim.x, (s32)dim.y, 0, 1, _v4(0.3f, 0.6f, 1.0f, 1.0f));
+    }
+
+    u32 line_height = imm_text_edit_line_height(font);
+    f32 width = dim.x - 8;
+    u32 visible_lines = (u32)((dim.y - 8) / (f32)line_height);
+    u32 end_line = u32_min_2(edit->scroll_line + visible_lines, edit->line_count);
+    u32 selection_min = imm_text_edit_selection_min(edit);
+    u32 selection_max = imm_text_edit_selection_max(edit);
+    f32 x = rect.min.x + 4;
+    f32 y = rect.min.y + 4;
+    for(u32 line = edit->scroll_line; line < end_line; ++line)
+    {
+        imm_text_layout_slot_t *slot = imm_text_edit_layout(edit, line);
+        u32 start = imm_text_edit_line_start(edit, line);
+        u32 length = slot->count - 1;
+
+        // NOTE: last byte that ends inside the rect, moved back to a codepoint start
+        u32 low = 0;
+        u32 high = length;
+        while(low < high)
+        {
+            u32 middle = (low + high + 1) / 2;
+            if(slot->x[middle] <= width)
+            {
+                low = middle;
+            }
+            else
+            {
+                high = middle - 1;
+            }
+        }
+        while(low > 0 && low < length && imm_utf8_is_continuation(imm_gap_buffer_at(&edit->text, start + low)))
+        {
+            low--;
+        }
+        u32 visible = low;
+
+        if(selection_min != selection_max && selection_min <= (start + length) && selection_max > start)
+        {
+            u32 from = u32_max_2(selection_min, start) - start;
+            u32 to = u32_min_2(selection_max, start + length) - start;
+            f32 x0 = f32_min_2(slot->x[from], width);
+            // NOTE: a selected '\n' is shown as a small box after the line
+            f32 x1 = f32_min_2(slot->x[to] + (selection_max > (start + length) ? (f32)font->size * 0.5f : 0), width);
+            imm_render_push_solid_quad(_v2(x + x0, y), _v2(x1 - x0, (f32)line_height), _v4(0.3f, 0.5f, 0.9f, 0.4f));
+        }
+
+        if(visible)
+        {
+            char *text = imm_arena_push_array(arena, char, visible);
+            if(text)
+            {
+                imm_gap_buffer_copy(&edit->text, start, visible, text);
+                imm_str_t str = {text, visible};
+                imm_text_run_t run = imm_text_run(str, font->font, font->style, font->size, _v3(0.85f, 0.85f, 0.85f));
+                imm_render_push_text_runs((s32)x, (s32)y, &run, 1);
+            }
+        }
+
+        if(focused && edit->caret >= start && edit->caret <= (start + length))
+        {
+            f32 caret_x = slot->x[edit->caret - start];
+            if(caret_x <= width)
+            {
+                imm_render_push_rect((s32)(x + caret_x), (s32)y, 2, (s32)line_height, 0.9f, 0.9f, 0.9f);
+            }
+        }
+        y += (f32)line_height;
+    }
+}
+
+// NOTE: every tile is an image quad sampling the cache texture of its image, so tiled
+// images with different caches can be drawn in the same frame
+void imm_render_push_tiled_image(imm_tiled_image_t *image, rect2d view, v2 center, f32 zoom)
+{
+    imm_tile_draw_t draws[256];
+    u32 draw_count = imm_tiled_image_visible(image, view, center, zoom, draws, array_count(draws));
+    for(u32 i = 0; i < draw_count; ++i)
+    {
+        imm_tile_draw_t *draw = draws + i;
+        imm_render_push_image_quad(draw->rect.min, draw->rect.max - draw->rect.min, draw->min_uv, draw->max_uv, image->texture_id);
+    }
+}
+
+// NOTE: cells of cell_size pixels in rows inside rect, every thumbnail is centered
+// in its cell keeping its aspect. The cells outside rect are not even asked to the
+// cache, so a grid of thousands of images only loads the visible ones
+void imm_render_push_thumbnail_grid(imm_thumbnail_cache_t *cache, const char **paths, u32 path_count, rect2d rect, u32 cell_size)
+{
+    u32 gap = 4;
+    u32 stride = cell_size + gap;
+    u32 columns = u32_max_2(1, (u32)(rect.max.x - rect.min.x + gap) / stride);
+    u32 rows = (u32)(rect.max.y - rect.min.y + gap) / stride;
+    u32 count = u32_min_2(path_count, columns * rows);
+    for(u32 i = 0; i < count; ++i)
+    {
+        v2 cell = rect.min + _v2((f32)((i % columns) * stride), (f32)((i / columns) * stride));
+        imm_thumbnail_draw_t draw;
+        imm_thumbnail_state_t state = imm_thumbnail_get(cache, paths[i], &draw);
+        if(state != thumbnail_ready)
+        {
+            f32 shade = (state == thumbnail_failed) ? 0.35f : 0.2f;
+            imm_render_push_rect((s32)cell.x, (s32)cell.y, (s32)cell_size, (s32)cell_size, shade, 0.2f, 0.2f);
+            continue;
+        }
+        f32 scale = (f32)cell_size / (f32)u32_max_2(draw.width, draw.height);
+        v2 dim = _v2((f32)draw.width * scale, (f32)draw.height * scale);
+        v2 pos = cell + (_v2((f32)cell_size, (f32)cell_size) - dim) * 0.5f;
+        imm_render_push_image_quad(pos, dim, draw.min_uv, draw.max_uv, draw.texture_id);
+    }
+}
+
+//
+// vector paths
+//
+// NOTE: lines are tessellated in one quad per segment grown one pixel to each side,
+// the fragment shader compute the coverage with the distance to the center line.
+// Before the tessellation the points are decimated to what can be seen in pixels
+
+#define imm_path_max_points KB(16)
+// NOTE: the extra floats let the simd loop read past the last point
+static f32 imm_path_x[imm_path_max_points + 4];
+static f32 imm_path_y[imm_path_max_points + 4];
+static u32 imm_path_count;
+
+inline imm_vertex_t imm_path_vertex(f32 x, f32 y, v4 color, f32 distance, f32 half_width, imm_primitive_kind_t kind)
+{
+    imm_vertex_t result = 
+    {
+        {x, y}, color, {0, distance}, {0, 0}, {half_width, 0, 0, (f32)kind}, 0
+    };
+    return result;
+}
+
+// NOTE: the fills of the paths have no shape, only the color
+inline imm_vertex_solid_t imm_path_solid_vertex(f32 x, f32 y, v4 color)
+{
+    imm_vertex_solid_t result = { {x, y}, color, 0 };
+    return result;
+}
+
+inline void imm_path_add_point(f32 x, f32 y)
+{
+    if(imm_path_count < imm_path_max_points)
+    {
+        imm_path_x[imm_path_count] = x;
+        imm_path_y[imm_path_count] = y;
+        imm_path_count++;
+    }
+}
+
+void imm_f32_min_max(f32 *values, u32 count, f32 *min, f32 *max)
+{
+    __m128 min_4 = _mm_set1_ps(f32_infinity());
+    __m128 max_4 = _mm_set1_ps(-f32_infinity());
+    u32 i = 0;
+    for(; (i + 4) <= count; i += 4)
+    {
+        __m128 v = _mm_loadu_ps(values + i);
+        min_4 = _mm_min_ps(min_4, v);
+        max_4 = _mm_max_ps(max_4, v);
+    }
+    min_4 = _mm_min_ps(min_4, _mm_shuffle_ps(min_4, min_4, _MM_SHUFFLE(1, 0, 3, 2)));
+    min_4 = _mm_min_ps(min_4, _mm_shuffle_ps(min_4, min_4, _MM_SHUFFLE(2, 3, 0, 1)));
+    max_4 = _mm_max_ps(max_4, _mm_shuffle_ps(max_4, max_4, _MM_SHUFFLE(1, 0, 3, 2)));
+    max_4 = _mm_max_ps(max_4, _mm_shuffle_ps(max_4, max_4, _MM_SHUFFLE(2, 3, 0, 1)));
+    f32 result_min = _mm_cvtss_f32(min_4);
+    f32 result_max = _mm_cvtss_f32(max_4);
+    for(; i < count; ++i)
+    {
+        result_min = f32_min_2(result_min, values[i]);
+        result_max = f32_max_2(result_max, values[i]);
+    }
+    *min = result_min;
+    *max = result_max;
+}
+
+// NOTE: series are evenly spaced along x, for every pixel column only the first,
+// min, max and last samples are keep. The decimated line cover the same pixels
+void imm_path_decimate_series(rect2d rect, f32 *values, u32 count, f32 min_value, f32 max_value)
+{
+    imm_path_count = 0;
+    if(count < 2)
+    {
+        return;
+    }
+    
+    f32 width = rect.max.x - rect.min.x;
+    f32 height = rect.max.y - rect.min.y;
+    // NOTE: a flat range, like an idle metric, is drawn at the middle of the rect
+    f32 base_y = rect.max.y;
+    f32 value_scale = 0;
+    if(max_value > min_value)
+    {
+        value_scale = height / (max_value - min_value);
+    }
+    else
+    {
+        base_y -= height * 0.5f;
+    }
+    u32 columns = u32_min_2((u32)width + 1, (imm_path_max_points / 4) - 1);
+
+    #define imm_series_y(v) (base_y - ((v) - min_value) * value_scale)
+    
+    if(count <= columns * 4)
+    {
+        f32 x_scale = width / (f32)(count - 1);
+        for(u32 i = 0; i < count; ++i)
+        {
+            imm_path_add_point(rect.min.x + (f32)i * x_scale, imm_series_y(values[i]));
+        }
+        return;
+    }
+
+    f32 column_width = width / (f32)columns;
+    f64 samples_per_column = (f64)count / (f64)columns;
+    for(u32 column = 0; column < columns; ++column)
+    {
+        u32 first = (u32)(column * samples_per_column);
+        u32 last = u32_min_2((u32)((column + 1) * samples_per_column), count);
+        if(first >= last)
+        {
+            continue;
+        }
+        
+        f32 min, max;
+        imm_f32_min_max(values + first, last - first, &min, &max);
+        
+        f32 x = rect.min.x + (f32)column * column_width;
+        f32 first_value = values[first];
+        f32 last_value = values[last - 1];
+        imm_path_add_point(x, imm_series_y(first_value));
+        // NOTE: go first to the extreme that is closer to the first sample
+        if((max - first_value) < (first_value - min))
+        {
+            imm_path_add_point(x + column_width * 0.5f, imm_series_y(max));
+            imm_path_add_point(x + column_width * 0.5f, imm_series_y(min));
+        }
+        else
+        {
+            imm_path_add_point(x + column_width * 0.5f, imm_series_y(min));
+            imm_path_add_point(x + column_width * 0.5f, imm_series_y(max));
+        }
+        imm_path_add_point(x + column_width, imm_series_y(last_value));
+    }
+    
+    #undef imm_series_y
+}
+
+// NOTE: generic polylines drop the points that are closer than half pixel to the last one
+void imm_path_decimate_points(v2 *points, u32 count)
+{
+    imm_path_count = 0;
+    if(count == 0)
+    {
+        return;
+    }
+    imm_path_add_point(points[0].x, points[0].y);
+    for(u32 i = 1; i < count; ++i)
+    {
+        f32 dx = points[i].x - imm_path_x[imm_path_count - 1];
+        f32 dy = points[i].y - imm_path_y[imm_path_count - 1];
+        if(((dx * dx) + (dy * dy)) >= 0.25f || (i == (count - 1)))
+        {
+            imm_path_add_point(points[i].x, points[i].y);
+        }
+    }
+}
+
+// NOTE: segment normals and corners are computed for four segments at once 
+void imm_path_tessellate_line(f32 thickness, v4 color)
+{
+    u32 segment_count = imm_path_count > 1 ? imm_path_count - 1 : 0;
+    f32 half_width = thickness * 0.5f;
+    f32 extent = half_width + 1.0f;
+
+    __m128 zero_4 = _mm_setzero_ps();
+    __m128 one_4 = _mm_set1_ps(1.0f);
+    __m128 extent_4 = _mm_set1_ps(extent);
+    __m128 cap_4 = _mm_set1_ps(half_width);
+    __m128 epsilon_4 = _mm_set1_ps(1e-12f);
+
+    for(u32 i = 0; i < segment_count; i += 4)
+    {
+        __m128 x0 = _mm_loadu_ps(imm_path_x + i);
+        __m128 y0 = _mm_loadu_ps(imm_path_y + i);
+        __m128 x1 = _mm_loadu_ps(imm_path_x + i + 1);
+        __m128 y1 = _mm_loadu_ps(imm_path_y + i + 1);
+        
+        __m128 dx = _mm_sub_ps(x1, x0);
+        __m128 dy = _mm_sub_ps(y1, y0);
+        __m128 length_sqr = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        __m128 inv_length = _mm_div_ps(one_4, _mm_sqrt_ps(_mm_max_ps(length_sqr, epsilon_4)));
+        dx = _mm_mul_ps(dx, inv_length);
+        dy = _mm_mul_ps(dy, inv_length);
+        
+        // NOTE: normal scaled by the extent and direction scaled by the square cap
+        __m128 nx = _mm_mul_ps(_mm_sub_ps(zero_4, dy), extent_4);
+        __m128 ny = _mm_mul_ps(dx, extent_4);
+        __m128 ax = _mm_sub_ps(x0, _mm_mul_ps(dx, cap_4));
+        __m128 ay = _mm_sub_ps(y0, _mm_mul_ps(dy, cap_4));
+        __m128 bx = _mm_add_ps(x1, _mm_mul_ps(dx, cap_4));
+        __m128 by = _mm_add_ps(y1, _mm_mul_ps(dy, cap_4));
+
+        f32 corners[8][4];
+        _mm_storeu_ps(corners[0], _mm_add_ps(ax, nx));
+        _mm_storeu_ps(corners[1], _mm_add_ps(ay, ny));
+        _mm_storeu_ps(corners[2], _mm_sub_ps(ax, nx));
+        _mm_storeu_ps(corners[3], _mm_sub_ps(ay, ny));
+        _mm_storeu_ps(corners[4], _mm_sub_ps(bx, nx));
+        _mm_storeu_ps(corners[5], _mm_sub_ps(by, ny));
+        _mm_storeu_ps(corners[6], _mm_add_ps(bx, nx));
+        _mm_storeu_ps(corners[7], _mm_add_ps(by, ny));
+        f32 lengths[4];
+        _mm_storeu_ps(lengths, length_sqr);
+
+        u32 lanes = u32_min_2(4, segment_count - i);
+        for(u32 lane = 0; lane < lanes; ++lane)
+        {
+            if(lengths[lane] == 0)
+            {
+                continue;
+            }
+            imm_vertex_t quad[4];
+            quad[0] = imm_path_vertex(corners[0][lane], corners[1][lane], color,  extent, half_width, primitive_kind_line);
+            quad[1] = imm_path_vertex(corners[2][lane], corners[3][lane], color, -extent, half_width, primitive_kind_line);
+            quad[2] = imm_path_vertex(corners[4][lane], corners[5][lane], color, -extent, half_width, primitive_kind_line);
+            quad[3] = imm_path_vertex(corners[6][lane], corners[7][lane], color,  extent, half_width, primitive_kind_line);
+            imm_render_push_triangles(quad, 4, imm_quad_indices, 6);
+        }
+    }
+}
+
+void imm_render_push_polyline(v2 *points, u32 count, f32 thickness, v4 color)
+{
+    imm_path_decimate_points(points, count);
+    imm_path_tessellate_line(thickness, color);
+}
+
+void imm_render_push_series(rect2d rect, f32 *values, u32 count, f32 min_value, f32 max_value, f32 thickness, v4 color)
+{
+    imm_path_decimate_series(rect, values, count, min_value, max_value);
+    imm_path_tessellate_line(thickness, color);
+}
+
+// NOTE: fill the area between the series and the bottom of the rect, the top edge 
+// is not anti-aliased so it is meant to be draw under the line of the series
+void imm_render_push_series_area(rect2d rect, f32 *values, u32 count, f32 min_value, f32 max_value, v4 color)
+{
+    imm_path_decimate_series(rect, values, count, min_value, max_value);
+    f32 bottom = rect.max.y;
+    for(u32 i = 0; (i + 1) < imm_path_count; ++i)
+    {
+        imm_vertex_solid_t quad[4];
+        quad[0] = imm_path_solid_vertex(imm_path_x[i], imm_path_y[i], color);
+        quad[1] = imm_path_solid_vertex(imm_path_x[i], bottom, color);
+        quad[2] = imm_path_solid_vertex(imm_path_x[i + 1], bottom, color);
+        quad[3] = imm_path_solid_vertex(imm_path_x[i + 1], imm_path_y[i + 1], color);
+        imm_render_push_triangles(quad, 4, imm_quad_indices, 6);
+    }
+}
+
+// NOTE: the inside is a triangle fan and every edge has one pixel fringe outside the
+// fan where the coverage goes from one to zero. The fringes never cover the fan or
+// each other, so translucent fills have no darker rim
+void imm_render_push_convex_path(v2 *points, u32 count, v4 color)
+{
+    if(count < 3)
+    {
+        return;
+    }
+    
+    f32 area = 0;
+    for(u32 i = 0; i < count; ++i)
+    {
+        v2 a = points[i];
+        v2 b = points[(i + 1) % count];
+        area += (a.x * b.y) - (b.x * a.y);
+    }
+    f32 winding = area > 0 ? -1.0f : 1.0f;
+    
+    for(u32 i = 1; (i + 1) < count; ++i)
+    {
+        imm_vertex_solid_t triangle[3];
+        triangle[0] = imm_path_solid_vertex(points[0].x, points[0].y, color);
+        triangle[1] = imm_path_solid_vertex(points[i].x, points[i].y, color);
+        triangle[2] = imm_path_solid_vertex(points[i + 1].x, points[i + 1].y, color);
+        u32 indices[3] = { 0, 1, 2 };
+        imm_render_push_triangles(triangle, 3, indices, 3);
+    }
+
+    for(u32 i = 0; i < count; ++i)
+    {
+        v2 a = points[i];
+        v2 b = points[(i + 1) % count];
+        if(v2_length_sqr(b - a) == 0)
+        {
+            continue;
+        }
+        v2 outside = v2_perp(v2_normalize(b - a)) * winding;
+        imm_vertex_t quad[4];
+        quad[0] = imm_path_vertex(a.x, a.y, color, 0, 0.5f, primitive_kind_line);
+        quad[1] = imm_path_vertex(a.x + outside.x, a.y + outside.y, color, 1, 0.5f, primitive_kind_line);
+        quad[2] = imm_path_vertex(b.x + outside.x, b.y + outside.y, color, 1, 0.5f, primitive_kind_line);
+        quad[3] = imm_path_vertex(b.x, b.y, color, 0, 0.5f, primitive_kind_line);
+        imm_render_push_triangles(quad, 4, imm_quad_indices, 6);
+    }
+}
+
+// NOTE: time the decimation and the tessellation of a series of count values drawn
+// in a plot of width pixels, every run starts with empty render buffers
+void imm_path_bench(f32 *values, u32 count, f32 width, u32 run_count)
+{
+    rect2d plot = rect2d_min_dim(_v2(0, 0), _v2(width, 110));
+    f64 frequency = (f64)SDL_GetPerformanceFrequency();
+    u64 decimate_ticks = 0;
+    u64 tessellate_ticks = 0;
+    u64 min_ticks = ~0ull;
+    u32 vertex_count = 0;
+    for(u32 run = 0; run < run_count; ++run)
+    {
+        imm_render_reset();
+        u64 start = SDL_GetPerformanceCounter();
+        imm_path_decimate_series(plot, values, count, -1.0f, 1.0f);
+        u64 middle = SDL_GetPerformanceCounter();
+        imm_path_tessellate_line(1.5f, _v4(1, 1, 1, 1));
+        u64 end = SDL_GetPerformanceCounter();
+        decimate_ticks += middle - start;
+        tessellate_ticks += end - middle;
+        min_ticks = (end - start) < min_ticks ? (end - start) : min_ticks;
+        vertex_count = imm_vertex_stream<imm_vertex_t>()->count;
+    }
+    imm_render_reset();
+    printf("[path-bench]: %u values in %.0f pixels, %u points %u vertices, %.3f ms decimate %.3f ms tessellate per run, best run %.3f ms\n",
+           count, width, imm_path_count, vertex_count, (f64)decimate_ticks * 1000.0 / frequency / (f64)run_count,
+           (f64)tessellate_ticks * 1000.0 / frequency / (f64)run_count, (f64)min_ticks * 1000.0 / frequency);
+}
+
+//
+// regression scenes
+//
+// NOTE: every scene only uses the inputs of the assets, never the time or the mouse,
+// so its frames are the same on every run of the same machine
+
+#define imm_regress_width 512
+#define imm_regress_height 256
+
+struct imm_regress_assets_t
+{
+    u32 image_texture;
+    imm_text_edit_t *edit;
+    imm_text_edit_font_t *edit_font;
+    imm_arena_t *arena;
+};
+
+void imm_regress_scene_shapes(void *)
+{
+    imm_render_push_rect(0, 0, imm_regress_width, imm_regress_height, 0.85f, 0.85f, 0.85f);
+    imm_render_push_shadow(20, 20, 200, 120, 12, 16, _v4(0, 0, 0, 0.6f));
+    imm_render_push_rounded_rect(20, 20, 200, 120, 12, _v4(0.95f, 0.95f, 0.95f, 1.0f));
+    imm_render_push_rect_border(40, 40, 120, 40, 8, 2, _v4(0.2f, 0.5f, 0.9f, 1.0f));
+    imm_render_push_circle(320, 80, 36, _v4(0.9f, 0.3f, 0.3f, 1.0f));
+    imm_render_push_circle_border(320, 80, 46, 3, _v4(0.2f, 0.2f, 0.2f, 1.0f));
+    for(s32 i = 0; i < 8; ++i)
+    {
+        imm_render_push_rect(20 + i * 30, 170, 24, 24, (f32)i / 8.0f, 0.4f, 1.0f - (f32)i / 8.0f);
+        imm_render_push_rounded_rect(260 + i * 30, 170, 24, 24, (f32)i * 1.5f, _v4(0.3f, 0.7f, 0.4f, 0.5f));
+    }
+}
+
+void imm_regress_scene_text(void *)
+{
+    imm_text_run_t runs[] =
+    {
+        imm_text_run("Regular, ", font_type_vera, font_style_regular, 16, _v3(0.9f, 0.9f, 0.9f)),
+        imm_text_run("bold, ", font_type_vera, font_style_bold, 16, _v3(1.0f, 0.8f, 0.3f)),
+        imm_text_run("italic ", font_type_vera, font_style_italic, 24, _v3(0.4f, 0.8f, 1.0f)),
+        imm_text_run("and bold italic\n", font_type_vera, font_style_bold_italic, 16, _v3(1.0f, 0.4f, 0.4f)),
+        imm_text_run("mono_code(x) ", font_type_jetbrains_mono, font_style_regular, 16, _v3(0.6f, 1.0f, 0.6f)),
+        imm_text_run("with fallback \xE2\x86\x92 \xC3\xB1", font_type_jetbrains_mono, font_style_bold, 16, _v3(0.9f, 0.9f, 0.9f)),
+    };
+    imm_render_push_text_runs(20, 20, runs, array_count(runs));
+    imm_render_push_rect(0, 120, imm_regress_width, 136, 0.95f, 0.95f, 0.95f);
+    imm_render_push_text_rect(20, 140, "The quick brown fox jumps over the lazy dog 0123456789", character_atlas_type_small);
+    imm_render_push_text_rect(20, 180, "Sphinx of black quartz, judge my vow", character_atlas_type_large);
+}
+
+void imm_regress_scene_paths(void *)
+{
+    f32 series[2048];
+    for(u32 i = 0; i < array_count(series); ++i)
+    {
+        f32 t = (f32)i / (f32)array_count(series);
+        series[i] = f32_sin(t * 40.0f) * 0.6f + f32_sin(t * 370.0f) * 0.3f;
+    }
+    rect2d plot = rect2d_min_dim(_v2(20, 20), _v2(472, 110));
+    imm_render_push_series_area(plot, series, array_count(series), -1.0f, 1.0f, _v4(0.2f, 0.5f, 0.9f, 0.3f));
+    imm_render_push_series(plot, series, array_count(series), -1.0f, 1.0f, 1.5f, _v4(0.2f, 0.5f, 0.9f, 1.0f));
+
+    v2 triangle[3] = { _v2(60, 150), _v2(110, 240), _v2(10, 240) };
+    imm_render_push_convex_path(triangle, 3, _v4(0.9f, 0.8f, 0.2f, 1.0f));
+    v2 polygon[6];
+    for(u32 i = 0; i < array_count(polygon); ++i)
+    {
+        f32 angle = (f32)i * (6.2831853f / (f32)array_count(polygon));
+        polygon[i] = _v2(200 + f32_cos(angle) * 45.0f, 195 + f32_sin(angle) * 45.0f);
+    }
+    imm_render_push_convex_path(polygon, array_count(polygon), _v4(0.3f, 0.8f, 0.5f, 0.8f));
+    v2 zigzag[16];
+    for(u32 i = 0; i < array_count(zigzag); ++i)
+    {
+        zigzag[i] = _v2(280 + (f32)i * 14.0f, (i & 1) ? 160.0f : 230.0f);
+    }
+    imm_render_push_polyline(zigzag, array_count(zigzag), 3.0f, _v4(0.9f, 0.3f, 0.6f, 1.0f));
+}
+
+void imm_regress_scene_text_edit(void *user)
+{
+    imm_regress_assets_t *assets = (imm_regress_assets_t *)user;
+    rect2d rect = rect2d_min_dim(_v2(10, 10), _v2(492, 236));
+    imm_render_push_text_edit(assets->edit, assets->edit_font, rect, true, assets->arena);
+}
+
+void imm_regress_scene_image(void *user)
+{
+    imm_regress_assets_t *assets = (imm_regress_assets_t *)user;
+    imm_render_push_image_quad(_v2(10, 10), _v2(236, 236), _v2(0, 0), _v2(1, 1), assets->image_texture);
+    imm_render_push_image_quad(_v2(266, 10), _v2(118, 118), _v2(0, 0), _v2(1, 1), assets->image_texture);
+    imm_render_push_image_quad(_v2(266, 138), _v2(236, 108), _v2(0.25f, 0.25f), _v2(0.75f, 0.5f), assets->image_texture);
+    imm_render_push_rounded_rect(400, 30, 80, 80, 16, _v4(0.1f, 0.1f, 0.1f, 0.5f));
+}
+
+// NOTE: the budgets are the median cpu time of a frame in ms and the allocations of
+// one frame. Once warm no scene should allocate, the frame memory is the arena
+static imm_regress_scene_t imm_regress_scenes[] =
+{
+    { "shapes", imm_regress_scene_shapes, 2.0f, 0 },
+    { "text", imm_regress_scene_text, 2.0f, 0 },
+    { "paths", imm_regress_scene_paths, 3.0f, 0 },
+    { "text_edit", imm_regress_scene_text_edit, 3.0f, 0 },
+    { "image", imm_regress_scene_image, 2.0f, 0 },
+};
+
+// NOTE: the cpu time of a frame goes from the first push to the submit, the gpu is not waited
+bool imm_regress_run(imm_window_t *window, imm_regress_assets_t *assets, const char *directory, bool update)
+{
+    imm_make_directory(directory);
+    u8 *pixels = (u8 *)imm_alloc((u64)window->width * window->height * 4, memory_tag_texture);
+    f64 frequency = (f64)SDL_GetPerformanceFrequency();
+    u32 passed = 0;
+    u32 without_golden = 0;
+    for(u32 i = 0; i < array_count(imm_regress_scenes); ++i)
+    {
+        imm_regress_scene_t *scene = imm_regress_scenes + i;
+        imm_regress_result_t result = {};
+        f64 frame_ms[imm_regress_frames];
+        for(u32 frame = 0; frame < (imm_regress_warmup_frames + imm_regress_frames); ++frame)
+        {
+            u64 allocations = imm_memory_allocation_count();
+            u64 start = SDL_GetPerformanceCounter();
+            scene->push(assets);
+            imm_character_atlas_update(&character_atlas);
+            imm_render_list_t list = imm_render_list_build(window->width, window->height, _v4(0.2f, 0.2f, 0.2f, 1.0f), character_atlas.texture_id, assets->image_texture);
+            imm_backend->buffer_upload(window, &list);
+            imm_backend->submit(window, &list);
+            imm_render_reset();
+            imm_arena_reset(assets->arena);
+            u64 end = SDL_GetPerformanceCounter();
+            allocations = imm_memory_allocation_count() - allocations;
+            if(frame < imm_regress_warmup_frames)
+            {
+                // NOTE: the glyphs asked by the first frames are in the atlas before the timed ones
+                imm_character_atlas_flush(&character_atlas);
+                continue;
+            }
+            frame_ms[frame - imm_regress_warmup_frames] = (f64)(end - start) * 1000.0 / frequency;
+            result.allocations = (allocations > result.allocations) ? allocations : result.allocations;
+        }
+        result.frame_ms = imm_regress_median(frame_ms, imm_regress_frames);
+        imm_backend->read_pixels(window, pixels);
+        passed += imm_regress_check(scene, &result, pixels, window->width, window->height, directory, update) ? 1 : 0;
+        without_golden += (!update && !result.has_golden) ? 1 : 0;
+    }
+    imm_free(pixels);
+    printf("[regress]: %u of %u scenes passed, %u without golden\n", passed, (u32)array_count(imm_regress_scenes), without_golden);
+    return passed == array_count(imm_regress_scenes);
+}
+
+int main(int argc, char **argv)
+{
+    SDL_Init(SDL_INIT_EVERYTHING);
+
+    int window_width = 1024;
+    int window_height = 512;
+    // NOTE: --regress draws the regression scenes in a hidden window and exits, with
+    // --update the goldens are written instead of compared
+    bool regress = (argc >= 2) && (strcmp(argv[1], "--regress") == 0);
+    bool regress_update = regress && (argc == 3) && (strcmp(argv[2], "--update") == 0);
+    u32 window_flags = 0;
+    if(regress)
+    {
+        window_width = imm_regress_width;
+        window_height = imm_regress_height;
+        window_flags = SDL_WINDOW_HIDDEN;
+    }
+    // NOTE: the gui buffers are static, only report them. The budgets are the memory
+    // the gui can use on a dense host, going over them prints a memory error
+    imm_memory_track(memory_tag_index, sizeof(imm_index_buffer));
+    imm_memory_set_budget(memory_tag_atlas, MB(4));
+    imm_memory_set_budget(memory_tag_gpu_texture, MB(128));
+
+    imm_backend = &imm_backend_gl;
+    // NOTE: the layouts and the vertex storage come from the format descriptors
+    imm_vertex_layout_t layouts[pipeline_count] = {};
+    imm_vertex_format_register<imm_vertex_t>(layouts);
+    imm_vertex_format_register<imm_vertex_solid_t>(layouts);
+    imm_vertex_format_register<imm_vertex_glyph_t>(layouts);
+    imm_vertex_format_register<imm_vertex_image_t>(layouts);
+    imm_backend->vertex_layout(layouts, pipeline_count, sizeof(imm_index_buffer));
+    
+    static imm_window_t window;
+    if(!imm_backend->window_open(&window, "immg", window_width, window_height, window_flags))
+    {
+        return 1;
+    }
+    imm_vertex_format_program_load<imm_vertex_t>("shaders/shader.vert", "shaders/shader.frag");
+    imm_vertex_format_program_load<imm_vertex_solid_t>("shaders/solid.vert", "shaders/solid.frag");
+    imm_vertex_format_program_load<imm_vertex_glyph_t>("shaders/glyph.vert", "shaders/glyph.frag");
+    imm_vertex_format_program_load<imm_vertex_image_t>("shaders/image.vert", "shaders/image.frag");
+
+    // NOTE: second view of the same gui, it shares the atlas and textures of the first
+    static imm_window_t mirror_window;
+    
+    imm_texture_init_kernels();
+    if((argc == 3) && (strcmp(argv[1], "--bench-bmp") == 0))
+    {
+        imm_texture_bench_bmp(argv[2], 8);
+    }
+    imm_texture_t test_texture = imm_texture_upload_bmp("data/test.bmp");
+
+    // NOTE: tiled image test, the pyramid of the test image is build the first time
+    imm_job_queue_t io_queue;
+    imm_job_queue_init(&io_queue, 2, "immg-io");
+    const char *tiles_path = "data/test.tiles";
+    if((argc == 3) && (strcmp(argv[1], "--tiles") == 0))
+    {
+        tiles_path = argv[2];
+    }
+    else if(FILE *tiles_file = fopen(tiles_path, "rb"))
+    {
+        fclose(tiles_file);
+    }
+    else
+    {
+        imm_tiled_image_build("data/test.bmp", tiles_path);
+    }
+    static imm_tiled_image_t tiled_image;
+    imm_tiled_image_open(&tiled_image, tiles_path, &io_queue);
+    rect2d tiled_view = rect2d_min_dim(_v2(620, 230), _v2(280, 140));
+    v2 tiled_center = _v2((f32)tiled_image.header.width * 0.5f, (f32)tiled_image.header.height * 0.5f);
+    f32 tiled_zoom = 0.5f;
+    bool tiled_dragging = false;
+
+    // NOTE: thumbnail grid test, the images of --thumbs or the test images. The
+    // resampling runs in its own queue so it never waits behind the tile loads
+    imm_resample_init_kernels();
+    imm_job_queue_t image_queue;
+    s32 cpu_count = SDL_GetCPUCount();
+    imm_job_queue_init(&image_queue, (cpu_count > 1) ? (u32)(cpu_count - 1) : 1, "immg-image");
+    if((argc == 3) && (strcmp(argv[1], "--bench-resample") == 0))
+    {
+        imm_resample_bench(argv[2], &image_queue, 256, 256);
+    }
+    static const char *default_thumbnails[] = { "data/test.bmp", "data/character_atlas.bmp" };
+    const char **thumbnail_paths = default_thumbnails;
+    u32 thumbnail_count = array_count(default_thumbnails);
+    if((argc > 2) && (strcmp(argv[1], "--thumbs") == 0))
+    {
+        thumbnail_paths = (const char **)(argv + 2);
+        thumbnail_count = (u32)(argc - 2);
+    }
+    static imm_thumbnail_cache_t thumbnail_cache;
+    imm_thumbnail_cache_init(&thumbnail_cache, &image_queue, "data/thumbs", 64, resample_filter_lanczos3);
 
-    glCreateVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-    
-    glCreateBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(imm_vertex_buffer), (void *)imm_vertex_buffer, GL_DYNAMIC_DRAW);
-    // TODO: create offset off macro to make this code more readable and less error prone
-    glEnableVertexAttribArray(0); // NOTE: vertex positions
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(imm_vertex_t), (const void *)(sizeof(float)*0));
-    glEnableVertexAttribArray(1); // NOTE: vertex uv coordinates 
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(imm_vertex_t), (const void *)(sizeof(float)*2));
-    glEnableVertexAttribArray(2); // NOTE: vretex colors
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(imm_vertex_t), (const void *)(sizeof(float)*4));
-
-    glCreateBuffers(1, &ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(imm_index_buffer), (void *)imm_index_buffer, GL_DYNAMIC_DRAW);
-    
-    unsigned int shader = imm_load_gl_shader("shaders/shader.vert", "shaders/shader.frag");
-    glUseProgram(shader);
-    
-    m4 projection = m4_ortho(0, (f32)window_width, 0, (f32)window_height, 0, 1.0f);
-    int projection_loc = glGetUniformLocation(shader, "projection");
-    glUniformMatrix4fv(projection_loc, 1, GL_TRUE, (const float *)projection.m);
-    
     // NOTE: load font test
     imm_character_atlas_init_types();
-    imm_character_atlas_write_to_disk(&character_atlas[character_atlas_type_small], "data/character_atlas_small.bmp");
-    imm_character_atlas_write_to_disk(&character_atlas[character_atlas_type_large], "data/character_atlas_large.bmp");
+    imm_character_atlas_write_to_disk(&character_atlas, "data/character_atlas.bmp");
+
+    if((argc == 2) && (strcmp(argv[1], "--bench-state") == 0))
+    {
+        imm_state_bench(10000, 1000);
+    }
+
+    // NOTE: text edit test, a big generated text or the file of --edit
+    if((argc == 2) && (strcmp(argv[1], "--bench-edit") == 0))
+    {
+        imm_text_edit_bench(500000, 100000, 16);
+    }
+    static imm_text_edit_font_t edit_font = { font_type_jetbrains_mono, font_style_regular, 16 };
+    static imm_text_edit_t text_edit;
+    imm_text_edit_init(&text_edit, imm_text_edit_measure_atlas, &edit_font);
+    rect2d edit_rect = rect2d_min_dim(_v2(330, 80), _v2(270, 200));
+    u32 edit_visible_lines = (u32)((edit_rect.max.y - edit_rect.min.y - 8) / (f32)imm_text_edit_line_height(&edit_font));
+    bool edit_focused = false;
+    bool edit_dragging = false;
+    u64 edit_file_size = 0;
+    char *edit_file = 0;
+    if((argc == 3) && (strcmp(argv[1], "--edit") == 0))
+    {
+        edit_file = (char *)imm_read_entire_file(argv[2], &edit_file_size);
+        // NOTE: the positions of the text edit are u32
+        if(edit_file && edit_file_size >= 0xFFFFFFFFull)
+        {
+            printf("[text-edit-error]: %s is over 4 GB\n", argv[2]);
+            imm_free(edit_file);
+            edit_file = 0;
+        }
+    }
+    if(edit_file)
+    {
+        imm_text_edit_set_text(&text_edit, edit_file, (u32)edit_file_size);
+    }
+    else
+    {
+        u32 edit_lines = 200000;
+        edit_file_size = (u64)edit_lines * 48;
+        edit_file = (char *)imm_alloc(edit_file_size, memory_tag_file_io);
+        u32 length = 0;
+        for(u32 line = 0; line < edit_lines; ++line)
+        {
+            length += (u32)snprintf(edit_file + length, (size_t)(edit_file_size - length), "%06u: fn(x) = x * %u;\n", line, line % 97);
+        }
+        imm_text_edit_set_text(&text_edit, edit_file, length);
+    }
+    imm_free(edit_file);
+    SDL_StartTextInput();
+
+    // NOTE: series test data
+    static f32 series[MB(1)];
+    for(u32 i = 0; i < array_count(series); ++i)
+    {
+        f32 t = (f32)i / (f32)array_count(series);
+        series[i] = f32_sin(t * 40.0f) * 0.6f + f32_sin(t * 3000.0f) * 0.3f + f32_sin((f32)i * 0.7f) * 0.1f;
+    }
+    if((argc == 2) && (strcmp(argv[1], "--bench-path") == 0))
+    {
+        imm_path_bench(series, array_count(series), 980, 200);
+    }
+
+    static imm_hit_grid_t hit_grid;
+    v2 mouse = _v2(-1, -1);
+    
+    imm_state_table_t state_table;
+    imm_state_table_init(&state_table, 1024);
+
+    // NOTE: transient memory of the frame, reset with the gui buffers
+    static imm_arena_t frame_arena;
+    imm_arena_init(&frame_arena, MB(1));
+    u64 frame_index = 0;
+    u64 frame_ticks = 0;
+
+    bool regress_passed = true;
+    if(regress)
+    {
+        imm_regress_assets_t regress_assets = { test_texture.texture_id, &text_edit, &edit_font, &frame_arena };
+        regress_passed = imm_regress_run(&window, &regress_assets, "data/regress", regress_update);
+    }
 
-    bool running = true;
+    bool running = !regress;
     while(running)
     {
         SDL_Event event;
@@ -458,37 +1904,249 @@ int main(int argc, char **argv)
             {
                 running = false;
             }break;   
+            case SDL_WINDOWEVENT:
+            {
+                if(event.window.event == SDL_WINDOWEVENT_CLOSE)
+                {
+                    if(event.window.windowID == mirror_window.id)
+                    {
+                        imm_backend->window_close(&mirror_window);
+                    }
+                    else
+                    {
+                        running = false;
+                    }
+                }
+            }break;
+            case SDL_MOUSEMOTION:
+            {
+                // NOTE: the mirror window only shows the gui
+                if(event.motion.windowID != window.id)
+                {
+                    break;
+                }
+                mouse = _v2((f32)event.motion.x, (f32)event.motion.y);
+                if(tiled_dragging)
+                {
+                    tiled_center = tiled_center - _v2((f32)event.motion.xrel, (f32)event.motion.yrel) / tiled_zoom;
+                }
+                if(edit_dragging)
+                {
+                    imm_text_edit_input_event(&text_edit);
+                    text_edit.caret = imm_text_edit_hit(&text_edit, &edit_font, edit_rect, mouse);
+                }
+            }break;
+            case SDL_MOUSEBUTTONDOWN:
+            case SDL_MOUSEBUTTONUP:
+            {
+                if(event.button.windowID != window.id)
+                {
+                    break;
+                }
+                bool inside = (mouse.x >= tiled_view.min.x) && (mouse.x < tiled_view.max.x) && (mouse.y >= tiled_view.min.y) && (mouse.y < tiled_view.max.y);
+                bool inside_edit = (mouse.x >= edit_rect.min.x) && (mouse.x < edit_rect.max.x) && (mouse.y >= edit_rect.min.y) && (mouse.y < edit_rect.max.y);
+                if(event.button.button == SDL_BUTTON_LEFT)
+                {
+                    tiled_dragging = (event.type == SDL_MOUSEBUTTONDOWN) && inside;
+                    edit_dragging = (event.type == SDL_MOUSEBUTTONDOWN) && inside_edit;
+                    if(event.type == SDL_MOUSEBUTTONDOWN)
+                    {
+                        edit_focused = inside_edit;
+                    }
+                    if(edit_dragging)
+                    {
+                        imm_text_edit_input_event(&text_edit);
+                        text_edit.caret = imm_text_edit_hit(&text_edit, &edit_font, edit_rect, mouse);
+                        text_edit.anchor = text_edit.caret;
+                        text_edit.preferred_x = imm_text_edit_x_of(&text_edit, text_edit.caret, 0);
+                    }
+                }
+            }break;
+            case SDL_MOUSEWHEEL:
+            {
+                bool inside_edit = (mouse.x >= edit_rect.min.x) && (mouse.x < edit_rect.max.x) && (mouse.y >= edit_rect.min.y) && (mouse.y < edit_rect.max.y);
+                if(inside_edit)
+                {
+                    u32 lines = 3 * (u32)(event.wheel.y > 0 ? event.wheel.y : -event.wheel.y);
+                    if(event.wheel.y > 0)
+                    {
+                        text_edit.scroll_line -= u32_min_2(lines, text_edit.scroll_line);
+                    }
+                    else
+                    {
+                        text_edit.scroll_line = u32_min_2(text_edit.scroll_line + lines, text_edit.line_count - 1);
+                    }
+                }
+                else
+                {
+                    tiled_zoom *= event.wheel.y > 0 ? 1.25f : 0.8f;
+                }
+            }break;
+            case SDL_TEXTINPUT:
+            {
+                if(edit_focused)
+                {
+                    imm_text_edit_input_event(&text_edit);
+                    imm_text_edit_type(&text_edit, event.text.text, (u32)strlen(event.text.text));
+                    imm_text_edit_scroll_to_caret(&text_edit, edit_visible_lines);
+                }
+            }break;
+            case SDL_KEYDOWN:
+            {
+                if(event.key.keysym.sym == SDLK_F1)
+                {
+                    imm_hit_stats_print(&hit_grid);
+                    imm_state_stats_print(&state_table);
+                    imm_arena_stats_print(&frame_arena, "frame");
+                    imm_overdraw_stats_print(&imm_overdraw, &window);
+                    imm_text_edit_stats_print(&text_edit);
+                    imm_thumbnail_stats_print(&thumbnail_cache);
+                    imm_memory_dump();
+                }
+                else if(event.key.keysym.sym == SDLK_F3)
+                {
+                    imm_overdraw_stats_print(&imm_overdraw, &window);
+                    imm_opaque_pass = !imm_opaque_pass;
+                    printf("[overdraw]: opaque pass %s\n", imm_opaque_pass ? "on" : "off");
+                }
+                else if(event.key.keysym.sym == SDLK_F4)
+                {
+                    if(mirror_window.open)
+                    {
+                        imm_backend->window_close(&mirror_window);
+                    }
+                    else
+                    {
+                        imm_backend->window_open(&mirror_window, "immg mirror", window_width / 2, window_height / 2, 0);
+                    }
+                }
+                else if(edit_focused)
+                {
+                    bool shift = (event.key.keysym.mod & KMOD_SHIFT) != 0;
+                    bool handled = true;
+                    switch(event.key.keysym.sym)
+                    {
+                    case SDLK_LEFT: imm_text_edit_key(&text_edit, text_edit_key_left, shift); break;
+                    case SDLK_RIGHT: imm_text_edit_key(&text_edit, text_edit_key_right, shift); break;
+                    case SDLK_UP: imm_text_edit_key(&text_edit, text_edit_key_up, shift); break;
+                    case SDLK_DOWN: imm_text_edit_key(&text_edit, text_edit_key_down, shift); break;
+                    case SDLK_HOME: imm_text_edit_key(&text_edit, text_edit_key_home, shift); break;
+                    case SDLK_END: imm_text_edit_key(&text_edit, text_edit_key_end, shift); break;
+                    case SDLK_BACKSPACE: imm_text_edit_key(&text_edit, text_edit_key_backspace, shift); break;
+                    case SDLK_DELETE: imm_text_edit_key(&text_edit, text_edit_key_delete, shift); break;
+                    case SDLK_RETURN: imm_text_edit_key(&text_edit, text_edit_key_enter, shift); break;
+                    default: handled = false; break;
+                    }
+                    if(handled)
+                    {
+                        imm_text_edit_input_event(&text_edit);
+                        imm_text_edit_scroll_to_caret(&text_edit, edit_visible_lines);
+                    }
+                }
+            }break;
             }
         }
+
+        // NOTE: hover is resolved with the rects registered the last frame
+        u32 hot_id = imm_hit_test(&hit_grid, mouse);
+        imm_hit_begin(&hit_grid, window_width, window_height);
+        rect2d screen = rect2d_min_max(_v2(0, 0), _v2((f32)window_width, (f32)window_height));
         
         imm_render_push_text_rect(20, 100, "Tomas Cabrerizo!", character_atlas_type_large); 
         imm_render_push_text_rect(20, 200, "Gonzalo Cabrerizo!", character_atlas_type_large); 
         imm_render_push_text_rect(20, 250, "Manuel Cabrerizo!", character_atlas_type_large); 
+        
+        u64 frame_start = SDL_GetPerformanceCounter();
+        imm_str_t frame_label = imm_text_f(&frame_arena, "frame %llu, %.3f ms, arena high water %llu bytes",
+                                           (unsigned long long)frame_index, (f64)frame_ticks * 1000.0 / (f64)SDL_GetPerformanceFrequency(),
+                                           (unsigned long long)frame_arena.high_water);
+        imm_render_push_text_rect(20, 20, frame_label, character_atlas_type_small);
+
+        // NOTE: sdf primitives test
+        imm_render_push_shadow(620, 60, 300, 160, 12, 16, _v4(0, 0, 0, 0.6f));
+        imm_id_push("panel");
+        u32 panel_id = imm_id("background");
+        u32 button_id = imm_id("button");
+        u32 circle_id = imm_id("circle");
+        imm_render_push_rounded_rect(620, 60, 300, 160, 12, _v4(0.95f, 0.95f, 0.95f, 1.0f));
+        imm_hit_register(&hit_grid, panel_id, rect2d_min_dim(_v2(620, 60), _v2(300, 160)), 0, screen);
+        imm_render_push_rect_border(640, 80, 120, 40, 8, 2, _v4(0.2f, 0.5f, 0.9f, 1.0f));
+        imm_hit_register(&hit_grid, button_id, rect2d_min_dim(_v2(640, 80), _v2(120, 40)), 1, screen);
+        // NOTE: the hover animation value lives in the persistent widget state
+        imm_widget_state_t *circle_state = imm_state_get(&state_table, circle_id);
+        f32 circle_target = hot_id == circle_id ? 1.0f : 0.0f;
+        circle_state->anim += (circle_target - circle_state->anim) * 0.2f;
+        imm_render_push_circle(840, 140, 30 + circle_state->anim * 6.0f, _v4(0.9f, 0.3f, 0.3f, 1.0f));
+        imm_hit_register(&hit_grid, circle_id, rect2d_min_dim(_v2(810, 110), _v2(60, 60)), 1, screen);
+        imm_id_pop();
+        imm_render_push_circle_border(840, 140, 40, 3, _v4(0.2f, 0.2f, 0.2f, 1.0f));
+
+        // NOTE: vector path test
+        rect2d plot = rect2d_min_dim(_v2(20, 380), _v2(980, 110));
+        imm_render_push_rect((s32)plot.min.x, (s32)plot.min.y, 980, 110, 0.15f, 0.15f, 0.15f);
+        imm_render_push_series_area(plot, series, array_count(series), -1.0f, 1.0f, _v4(0.2f, 0.5f, 0.9f, 0.3f));
+        imm_render_push_series(plot, series, array_count(series), -1.0f, 1.0f, 1.5f, _v4(0.3f, 0.7f, 1.0f, 1.0f));
+        imm_render_push_rect((s32)tiled_view.min.x, (s32)tiled_view.min.y, 280, 140, 0.1f, 0.1f, 0.1f);
+        imm_render_push_tiled_image(&tiled_image, tiled_view, tiled_center, tiled_zoom);
+        imm_render_push_thumbnail_grid(&thumbnail_cache, thumbnail_paths, thumbnail_count, rect2d_min_dim(_v2(934, 60), _v2(84, 172)), 40);
+        
+        v2 triangle[3] = { _v2(960, 240), _v2(1000, 320), _v2(920, 320) };
+        imm_render_push_convex_path(triangle, 3, _v4(0.9f, 0.8f, 0.2f, 1.0f));
 
-        // TODO: test if glBufferSubData us faster than glMapBuffer
-        // NOTE: copy gui buffers into GPU 
-        void *vertex_buffer = glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
-        memcpy(vertex_buffer, imm_vertex_buffer, imm_vertex_buffer_count * sizeof(imm_vertex_t));
-        glUnmapBuffer(GL_ARRAY_BUFFER);
+        // NOTE: rich text test, every style in the same draw call
+        imm_text_run_t runs[] =
+        {
+            imm_text_run("Regular, ", font_type_vera, font_style_regular, 16, _v3(0.9f, 0.9f, 0.9f)),
+            imm_text_run("bold, ", font_type_vera, font_style_bold, 16, _v3(1.0f, 0.8f, 0.3f)),
+            imm_text_run("italic ", font_type_vera, font_style_italic, 24, _v3(0.4f, 0.8f, 1.0f)),
+            imm_text_run("and bold italic\n", font_type_vera, font_style_bold_italic, 16, _v3(1.0f, 0.4f, 0.4f)),
+            imm_text_run("mono_code(x) ", font_type_jetbrains_mono, font_style_regular, 16, _v3(0.6f, 1.0f, 0.6f)),
+            imm_text_run("with fallback \xE2\x86\x92 \xC3\xB1", font_type_jetbrains_mono, font_style_bold, 16, _v3(0.9f, 0.9f, 0.9f)),
+        };
+        imm_render_push_text_runs(20, 300, runs, array_count(runs));
 
-        void *index_buffer = glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY);
-        memcpy(index_buffer, imm_index_buffer, imm_index_buffer_count * sizeof(u32));
-        glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+        imm_render_push_text_edit(&text_edit, &edit_font, edit_rect, edit_focused, &frame_arena);
+        
+        imm_character_atlas_update(&character_atlas);
+        imm_tiled_image_update(&tiled_image);
+        imm_thumbnail_cache_update(&thumbnail_cache);
 
-        glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        // NOTE: the same list is drawn by every window, the textures are shared. The
+        // mirror window is half the size and shows the whole gui scaled down
+        imm_render_list_t list = imm_render_list_build(window_width, window_height, _v4(0.2f, 0.2f, 0.2f, 1.0f), character_atlas.texture_id, tiled_image.texture_id);
         
-        glDrawElements(GL_TRIANGLES, imm_index_buffer_count, GL_UNSIGNED_INT, 0);
-        SDL_GL_SwapWindow(window);
+        imm_backend->buffer_upload(&window, &list);
+        imm_backend->submit(&window, &list);
+        imm_backend->present(&window);
+        if(mirror_window.open)
+        {
+            imm_backend->buffer_upload(&mirror_window, &list);
+            imm_backend->submit(&mirror_window, &list);
+            imm_backend->present(&mirror_window);
+        }
+        imm_overdraw_end_frame(&imm_overdraw);
+        imm_text_edit_presented(&text_edit);
 
-        // NOTE: clear gui buffers
-        imm_vertex_buffer_count = 0;
-        imm_index_buffer_count = 0;
-        imm_index_offset = 0;
-    }
+        imm_hit_build(&hit_grid);
+        imm_state_end_frame(&state_table);
 
-    SDL_GL_DeleteContext(gl_ctx);
-    SDL_DestroyWindow(window);
+        imm_render_reset();
+        imm_arena_reset(&frame_arena);
+        frame_ticks = SDL_GetPerformanceCounter() - frame_start;
+        frame_index++;
+    }
 
-    return 0;
+    // NOTE: the shared objects are deleted with the first window still open
+    imm_backend->window_close(&mirror_window);
+    imm_tiled_image_close(&tiled_image);
+    imm_job_queue_shutdown(&io_queue);
+    imm_thumbnail_cache_shutdown(&thumbnail_cache);
+    imm_job_queue_shutdown(&image_queue);
+    imm_text_edit_free(&text_edit);
+    imm_character_atlas_shutdown(&character_atlas);
+    imm_arena_free(&frame_arena);
+    imm_texture_free(&test_texture);
+    imm_backend->window_close(&window);
+
+    return regress_passed ? 0 : 1;
 }